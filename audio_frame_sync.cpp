@@ -0,0 +1,106 @@
+#include "audio_frame_sync.h"
+
+static _FORCE_INLINE_ uint64_t _smooth(uint64_t p_average, uint64_t p_sample) {
+	// Exponential moving average with a 1/16 weight.
+	return uint64_t(int64_t(p_average) + (int64_t(p_sample) - int64_t(p_average)) / 16);
+}
+
+void AudioFrameSync::notify_callback(uint64_t p_now_nsec, int p_frames, int p_mix_rate) {
+	if (reset_requested.is_set()) {
+		last_callback_nsec.set(0);
+		period_nsec.set(0);
+		jitter_nsec.set(0);
+		callbacks.set(0);
+		lead_nsec.set(0);
+		missed_callbacks.set(0);
+		reset_requested.clear();
+	}
+
+	if (p_mix_rate > 0) {
+		buffer_nsec.set(uint64_t(p_frames) * 1000000000 / uint64_t(p_mix_rate));
+	}
+
+	uint64_t last = last_callback_nsec.get();
+	if (last > 0 && p_now_nsec > last) {
+		uint64_t period = p_now_nsec - last;
+		uint64_t average = period_nsec.get();
+		if (average == 0) {
+			period_nsec.set(period);
+		} else {
+			jitter_nsec.set(_smooth(jitter_nsec.get(), period > average ? period - average : average - period));
+			period_nsec.set(_smooth(average, period));
+		}
+
+		uint64_t frame_end = last_frame_end_nsec.get();
+		if (frame_end > last) {
+			lead_nsec.set(_smooth(lead_nsec.get(), p_now_nsec - frame_end));
+		} else {
+			// No frame finished between the two callbacks, this buffer got stale data.
+			missed_callbacks.increment();
+		}
+	}
+
+	last_callback_nsec.set(p_now_nsec);
+	callbacks.increment();
+}
+
+void AudioFrameSync::notify_frame_end(uint64_t p_now_nsec, uint64_t p_frame_start_nsec) {
+	if (p_frame_start_nsec > 0 && p_now_nsec > p_frame_start_nsec) {
+		uint64_t work = p_now_nsec - p_frame_start_nsec;
+		uint64_t average = work_nsec.get();
+		work_nsec.set(average == 0 ? work : _smooth(average, work));
+	}
+	last_frame_end_nsec.set(p_now_nsec);
+}
+
+// Time left between the end of a frame and the callback that pulls its audio. Whatever
+// the output latency budget leaves after the driver buffer goes to this margin, so frames
+// miss fewer callbacks without exceeding the configured latency.
+uint64_t AudioFrameSync::_get_margin_nsec() const {
+	uint64_t margin = MAX(MIN_MARGIN_NSEC, 2 * jitter_nsec.get());
+	uint64_t latency = output_latency_nsec.get();
+	uint64_t buffer = buffer_nsec.get();
+	if (latency > buffer) {
+		margin = MAX(margin, latency - buffer);
+	}
+	return margin;
+}
+
+// Latest frame start, no earlier than p_earliest_nsec, that still lets the frame
+// finish (based on the measured frame work time) right before an audio callback.
+uint64_t AudioFrameSync::get_next_frame_start(uint64_t p_earliest_nsec) const {
+	uint64_t period = period_nsec.get();
+	uint64_t last = last_callback_nsec.get();
+	if (!is_synced() || period == 0) {
+		return p_earliest_nsec;
+	}
+
+	uint64_t lead = work_nsec.get() + _get_margin_nsec();
+	uint64_t callback = last + period;
+	if (callback < p_earliest_nsec + lead) {
+		callback += ((p_earliest_nsec + lead - callback) / period + 1) * period;
+	}
+	return callback - lead;
+}
+
+Dictionary AudioFrameSync::get_stats() const {
+	Dictionary stats;
+	stats["callbacks"] = callbacks.get();
+	stats["synced"] = is_synced();
+	stats["callback_period"] = period_nsec.get() / 1000000.0;
+	stats["callback_jitter"] = jitter_nsec.get() / 1000000.0;
+	stats["buffer_latency"] = buffer_nsec.get() / 1000000.0;
+	stats["frame_work_time"] = work_nsec.get() / 1000000.0;
+	stats["frame_lead_time"] = lead_nsec.get() / 1000000.0;
+	stats["missed_callbacks"] = missed_callbacks.get();
+	stats["frame_margin"] = _get_margin_nsec() / 1000000.0;
+	return stats;
+}
+
+// Main thread only. The audio thread's values are cleared by its next callback, until
+// then is_synced() returns false.
+void AudioFrameSync::reset() {
+	last_frame_end_nsec.set(0);
+	work_nsec.set(0);
+	reset_requested.set();
+}
@@ -0,0 +1,46 @@
+#ifndef AUDIO_FRAME_SYNC_H
+#define AUDIO_FRAME_SYNC_H
+
+#include "core/templates/safe_refcount.h"
+#include "core/variant/dictionary.h"
+
+// Tracks when the audio driver pulls buffers, so the main loop can start a frame just
+// in time for its output to make the next audio callback. The audio thread only writes
+// atomics, it never waits on the main loop. The main thread never writes the audio
+// thread's values either, reset() asks the next callback to clear them.
+class AudioFrameSync {
+	static constexpr uint64_t MIN_MARGIN_NSEC = 250000; // 0.25 ms.
+	static constexpr int SYNC_MIN_CALLBACKS = 8;
+
+	// Written by the audio thread.
+	SafeNumeric<uint64_t> last_callback_nsec;
+	SafeNumeric<uint64_t> period_nsec;
+	SafeNumeric<uint64_t> jitter_nsec;
+	SafeNumeric<uint64_t> buffer_nsec;
+	SafeNumeric<uint64_t> callbacks;
+	SafeNumeric<uint64_t> lead_nsec;
+	SafeNumeric<uint64_t> missed_callbacks;
+
+	// Written by the main thread.
+	SafeNumeric<uint64_t> last_frame_end_nsec;
+	SafeNumeric<uint64_t> work_nsec;
+	SafeNumeric<uint64_t> output_latency_nsec;
+	SafeFlag reset_requested;
+
+	uint64_t _get_margin_nsec() const;
+
+public:
+	void notify_callback(uint64_t p_now_nsec, int p_frames, int p_mix_rate);
+	void notify_frame_end(uint64_t p_now_nsec, uint64_t p_frame_start_nsec);
+
+	// Latency budget from the end of a frame to its audio being output.
+	void set_output_latency(uint64_t p_nsec) { output_latency_nsec.set(p_nsec); }
+
+	bool is_synced() const { return !reset_requested.is_set() && callbacks.get() >= SYNC_MIN_CALLBACKS; }
+	uint64_t get_next_frame_start(uint64_t p_earliest_nsec) const;
+
+	Dictionary get_stats() const;
+	void reset();
+};
+
+#endif // AUDIO_FRAME_SYNC_H
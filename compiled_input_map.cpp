@@ -0,0 +1,389 @@
+#include "compiled_input_map.h"
+
+#include "core/input/input_map.h"
+#include "core/io/file_access.h"
+#include "core/io/marshalls.h"
+
+// Shift, Alt, Meta and Ctrl, as used in the event keys.
+static constexpr uint32_t MODIFIER_SHIFT = 25;
+static constexpr uint32_t MODIFIER_BITS = 0xF;
+
+uint64_t CompiledInputMap::_make_key(EventType p_type, uint32_t p_code, uint32_t p_modifiers) {
+	return (uint64_t(p_type) << 56) | (uint64_t((p_modifiers >> MODIFIER_SHIFT) & MODIFIER_BITS) << 32) | p_code;
+}
+
+uint32_t CompiledInputMap::_get_joy_motion_code(JoyAxis p_axis, float p_value) {
+	return uint32_t(p_axis) * 2 + (p_value < 0 ? 1 : 0);
+}
+
+bool CompiledInputMap::_compile_event(const Ref<InputEvent> &p_event, Event &r_event) {
+	ERR_FAIL_COND_V(p_event.is_null(), false);
+	r_event.device = p_event->get_device();
+
+	Ref<InputEventWithModifiers> with_modifiers = p_event;
+	if (with_modifiers.is_valid()) {
+		r_event.modifiers = (uint32_t)with_modifiers->get_modifiers_mask();
+		if (with_modifiers->is_command_or_control_autoremap()) {
+			r_event.flags |= FLAG_COMMAND_OR_CONTROL_AUTOREMAP;
+		}
+	}
+
+	Ref<InputEventKey> k = p_event;
+	if (k.is_valid()) {
+		if (k->get_keycode() != Key::NONE) {
+			r_event.type = EVENT_KEY;
+			r_event.code = uint32_t(k->get_keycode());
+		} else if (k->get_physical_keycode() != Key::NONE) {
+			r_event.type = EVENT_PHYSICAL_KEY;
+			r_event.code = uint32_t(k->get_physical_keycode());
+		} else if (k->get_key_label() != Key::NONE) {
+			r_event.type = EVENT_KEY_LABEL;
+			r_event.code = uint32_t(k->get_key_label());
+		} else {
+			return false;
+		}
+		r_event.unicode = k->get_unicode();
+		r_event.key = _make_key(r_event.type, r_event.code, r_event.modifiers);
+		return true;
+	}
+
+	Ref<InputEventMouseButton> mb = p_event;
+	if (mb.is_valid()) {
+		r_event.type = EVENT_MOUSE_BUTTON;
+		r_event.code = uint32_t(mb->get_button_index());
+		if (mb->is_double_click()) {
+			r_event.flags |= FLAG_DOUBLE_CLICK;
+		}
+		r_event.key = _make_key(r_event.type, r_event.code, r_event.modifiers);
+		return true;
+	}
+
+	Ref<InputEventJoypadButton> jb = p_event;
+	if (jb.is_valid()) {
+		r_event.type = EVENT_JOY_BUTTON;
+		r_event.code = uint32_t(jb->get_button_index());
+		r_event.key = _make_key(r_event.type, r_event.code, 0);
+		return true;
+	}
+
+	Ref<InputEventJoypadMotion> jm = p_event;
+	if (jm.is_valid()) {
+		r_event.type = EVENT_JOY_MOTION;
+		r_event.code = uint32_t(jm->get_axis());
+		r_event.axis_value = jm->get_axis_value();
+		r_event.key = _make_key(r_event.type, _get_joy_motion_code(jm->get_axis(), r_event.axis_value), 0);
+		return true;
+	}
+
+	return false;
+}
+
+void CompiledInputMap::add_action(const StringName &p_name, float p_deadzone, const Array &p_events) {
+	ERR_FAIL_COND_MSG(action_indices.has(p_name), "Action '" + String(p_name) + "' was already added.");
+
+	Action action;
+	action.name = p_name;
+	action.deadzone = p_deadzone;
+	action.first_event = events.size();
+
+	uint32_t action_index = actions.size();
+	for (int i = 0; i < p_events.size(); i++) {
+		Event event;
+		event.action = action_index;
+		if (!_compile_event(p_events[i], event)) {
+			WARN_VERBOSE(vformat("Skipping an event of action '%s' that can't be compiled.", p_name));
+			continue;
+		}
+		event_lookup[event.key].push_back(events.size());
+		events.push_back(event);
+	}
+
+	action.event_count = events.size() - action.first_event;
+	action_indices[p_name] = action_index;
+	actions.push_back(action);
+}
+
+int CompiledInputMap::get_action_index(const StringName &p_name) const {
+	const uint32_t *index = action_indices.getptr(p_name);
+	return index ? int(*index) : -1;
+}
+
+Ref<InputEvent> CompiledInputMap::create_event(uint32_t p_index) const {
+	ERR_FAIL_UNSIGNED_INDEX_V(p_index, events.size(), Ref<InputEvent>());
+	const Event &e = events[p_index];
+
+	Ref<InputEvent> event;
+	Ref<InputEventWithModifiers> with_modifiers;
+	switch (e.type) {
+		case EVENT_KEY:
+		case EVENT_PHYSICAL_KEY:
+		case EVENT_KEY_LABEL: {
+			Ref<InputEventKey> k;
+			k.instantiate();
+			if (e.type == EVENT_KEY) {
+				k->set_keycode(Key(e.code));
+			} else if (e.type == EVENT_PHYSICAL_KEY) {
+				k->set_physical_keycode(Key(e.code));
+			} else {
+				k->set_key_label(Key(e.code));
+			}
+			k->set_unicode(e.unicode);
+			event = k;
+			with_modifiers = k;
+		} break;
+		case EVENT_MOUSE_BUTTON: {
+			Ref<InputEventMouseButton> mb;
+			mb.instantiate();
+			mb->set_button_index(MouseButton(e.code));
+			mb->set_double_click(e.flags & FLAG_DOUBLE_CLICK);
+			event = mb;
+			with_modifiers = mb;
+		} break;
+		case EVENT_JOY_BUTTON: {
+			Ref<InputEventJoypadButton> jb;
+			jb.instantiate();
+			jb->set_button_index(JoyButton(e.code));
+			event = jb;
+		} break;
+		case EVENT_JOY_MOTION: {
+			Ref<InputEventJoypadMotion> jm;
+			jm.instantiate();
+			jm->set_axis(JoyAxis(e.code));
+			jm->set_axis_value(e.axis_value);
+			event = jm;
+		} break;
+	}
+
+	if (with_modifiers.is_valid()) {
+		with_modifiers->set_shift_pressed(e.modifiers & uint32_t(KeyModifierMask::SHIFT));
+		with_modifiers->set_alt_pressed(e.modifiers & uint32_t(KeyModifierMask::ALT));
+		with_modifiers->set_meta_pressed(e.modifiers & uint32_t(KeyModifierMask::META));
+		with_modifiers->set_ctrl_pressed(e.modifiers & uint32_t(KeyModifierMask::CTRL));
+		with_modifiers->set_command_or_control_autoremap(e.flags & FLAG_COMMAND_OR_CONTROL_AUTOREMAP);
+	}
+	event->set_device(e.device);
+	return event;
+}
+
+void CompiledInputMap::_lookup(EventType p_type, uint32_t p_code, uint32_t p_modifiers, int p_device, bool p_exact_match, LocalVector<uint32_t> &r_actions) const {
+	// Without an exact match, the modifiers of an action only need to be a subset of the
+	// pressed ones, so every subset is looked up (at most 16).
+	uint32_t pressed = (p_modifiers >> MODIFIER_SHIFT) & MODIFIER_BITS;
+	uint32_t subset = pressed;
+	while (true) {
+		const LocalVector<uint32_t> *candidates = event_lookup.getptr(_make_key(p_type, p_code, subset << MODIFIER_SHIFT));
+		if (candidates) {
+			for (uint32_t index : *candidates) {
+				const Event &e = events[index];
+				if ((e.device == InputMap::ALL_DEVICES || e.device == p_device) && !r_actions.has(e.action)) {
+					r_actions.push_back(e.action);
+				}
+			}
+		}
+		if (p_exact_match || subset == 0) {
+			break;
+		}
+		subset = (subset - 1) & pressed;
+	}
+}
+
+void CompiledInputMap::get_actions_for_event(const Ref<InputEvent> &p_event, LocalVector<uint32_t> &r_actions, bool p_exact_match) const {
+	ERR_FAIL_COND(p_event.is_null());
+	int device = p_event->get_device();
+
+	Ref<InputEventKey> k = p_event;
+	if (k.is_valid()) {
+		// Released keys match regardless of modifiers.
+		uint32_t modifiers = (k->is_pressed() || p_exact_match) ? (uint32_t)k->get_modifiers_mask() : (MODIFIER_BITS << MODIFIER_SHIFT);
+		if (k->get_keycode() != Key::NONE) {
+			_lookup(EVENT_KEY, uint32_t(k->get_keycode()), modifiers, device, p_exact_match, r_actions);
+		}
+		if (k->get_physical_keycode() != Key::NONE) {
+			_lookup(EVENT_PHYSICAL_KEY, uint32_t(k->get_physical_keycode()), modifiers, device, p_exact_match, r_actions);
+		}
+		if (k->get_key_label() != Key::NONE) {
+			_lookup(EVENT_KEY_LABEL, uint32_t(k->get_key_label()), modifiers, device, p_exact_match, r_actions);
+		}
+		return;
+	}
+
+	Ref<InputEventMouseButton> mb = p_event;
+	if (mb.is_valid()) {
+		uint32_t modifiers = (mb->is_pressed() || p_exact_match) ? (uint32_t)mb->get_modifiers_mask() : (MODIFIER_BITS << MODIFIER_SHIFT);
+		_lookup(EVENT_MOUSE_BUTTON, uint32_t(mb->get_button_index()), modifiers, device, p_exact_match, r_actions);
+		return;
+	}
+
+	Ref<InputEventJoypadButton> jb = p_event;
+	if (jb.is_valid()) {
+		_lookup(EVENT_JOY_BUTTON, uint32_t(jb->get_button_index()), 0, device, true, r_actions);
+		return;
+	}
+
+	Ref<InputEventJoypadMotion> jm = p_event;
+	if (jm.is_valid()) {
+		// Both sides, the one the axis moved away from has to be released.
+		_lookup(EVENT_JOY_MOTION, _get_joy_motion_code(jm->get_axis(), 1), 0, device, true, r_actions);
+		_lookup(EVENT_JOY_MOTION, _get_joy_motion_code(jm->get_axis(), -1), 0, device, true, r_actions);
+	}
+}
+
+// Rebuilds the lookup table after loading. Command-or-control events are resolved again,
+// as the map may have been compiled on another platform.
+void CompiledInputMap::_index_events() {
+	event_lookup.clear();
+	for (uint32_t i = 0; i < events.size(); i++) {
+		Event &e = events[i];
+		if (e.flags & FLAG_COMMAND_OR_CONTROL_AUTOREMAP) {
+			Ref<InputEventWithModifiers> with_modifiers = create_event(i);
+			e.modifiers = (uint32_t)with_modifiers->get_modifiers_mask();
+		}
+		uint32_t code = e.type == EVENT_JOY_MOTION ? _get_joy_motion_code(JoyAxis(e.code), e.axis_value) : e.code;
+		e.key = _make_key(e.type, code, e.modifiers);
+		event_lookup[e.key].push_back(i);
+	}
+}
+
+// File layout: a header, fixed-size action and event records, then the action names.
+Error CompiledInputMap::save(const String &p_path, uint32_t p_source_hash) const {
+	LocalVector<CharString> names;
+	uint32_t names_size = 0;
+	for (const Action &action : actions) {
+		names.push_back(String(action.name).utf8());
+		names_size += names[names.size() - 1].length() + 1;
+	}
+
+	uint32_t payload_size = actions.size() * ACTION_RECORD_SIZE + events.size() * EVENT_RECORD_SIZE + names_size;
+	Vector<uint8_t> buffer;
+	buffer.resize(HEADER_SIZE + payload_size);
+	uint8_t *w = buffer.ptrw();
+	uint8_t *payload = w + HEADER_SIZE;
+
+	uint8_t *p = payload;
+	uint32_t name_offset = 0;
+	for (uint32_t i = 0; i < actions.size(); i++) {
+		p += encode_uint32(name_offset, p);
+		p += encode_float(actions[i].deadzone, p);
+		p += encode_uint32(actions[i].first_event, p);
+		p += encode_uint32(actions[i].event_count, p);
+		name_offset += names[i].length() + 1;
+	}
+	for (const Event &e : events) {
+		p += encode_uint64(e.key, p);
+		p += encode_uint32(e.action, p);
+		p += encode_uint32(uint32_t(e.device), p);
+		p += encode_uint32(e.code, p);
+		p += encode_uint32(e.unicode, p);
+		p += encode_uint32(e.modifiers, p);
+		p += encode_float(e.axis_value, p);
+		*p++ = e.type;
+		*p++ = e.flags;
+		*p++ = 0;
+		*p++ = 0;
+	}
+	for (const CharString &name : names) {
+		memcpy(p, name.get_data(), name.length() + 1);
+		p += name.length() + 1;
+	}
+
+	p = w;
+	p += encode_uint32(MAGIC, p);
+	p += encode_uint32(VERSION, p);
+	p += encode_uint32(hash_murmur3_buffer(payload, payload_size), p);
+	p += encode_uint32(actions.size(), p);
+	p += encode_uint32(events.size(), p);
+	p += encode_uint32(payload_size, p);
+	encode_uint32(p_source_hash, p);
+
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::WRITE);
+	ERR_FAIL_COND_V_MSG(file.is_null(), ERR_FILE_CANT_WRITE, "Couldn't save compiled input map to '" + p_path + "'.");
+	file->store_buffer(buffer.ptr(), buffer.size());
+	return OK;
+}
+
+Error CompiledInputMap::load(const String &p_path, uint32_t p_source_hash) {
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ);
+	if (file.is_null()) {
+		return ERR_FILE_NOT_FOUND;
+	}
+
+	uint64_t length = file->get_length();
+	if (length < HEADER_SIZE) {
+		return ERR_FILE_CORRUPT;
+	}
+	Vector<uint8_t> buffer;
+	buffer.resize(length);
+	if (file->get_buffer(buffer.ptrw(), length) != length) {
+		return ERR_FILE_CORRUPT;
+	}
+
+	const uint8_t *r = buffer.ptr();
+	if (decode_uint32(r) != MAGIC || decode_uint32(r + 4) != VERSION) {
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	uint32_t hash = decode_uint32(r + 8);
+	uint32_t action_count = decode_uint32(r + 12);
+	uint32_t event_count = decode_uint32(r + 16);
+	uint32_t payload_size = decode_uint32(r + 20);
+	if (decode_uint32(r + 24) != p_source_hash) {
+		return ERR_FILE_CANT_OPEN; // Compiled from other settings.
+	}
+
+	const uint8_t *payload = r + HEADER_SIZE;
+	uint64_t records_size = uint64_t(action_count) * ACTION_RECORD_SIZE + uint64_t(event_count) * EVENT_RECORD_SIZE;
+	if (payload_size != length - HEADER_SIZE || records_size > payload_size || hash_murmur3_buffer(payload, payload_size) != hash) {
+		return ERR_FILE_CORRUPT;
+	}
+
+	const char *names = reinterpret_cast<const char *>(payload + records_size);
+	uint32_t names_size = payload_size - records_size;
+	if (names_size > 0 && names[names_size - 1] != 0) {
+		return ERR_FILE_CORRUPT;
+	}
+
+	clear();
+	actions.resize(action_count);
+	events.resize(event_count);
+
+	const uint8_t *p = payload;
+	for (uint32_t i = 0; i < action_count; i++, p += ACTION_RECORD_SIZE) {
+		Action &action = actions[i];
+		uint32_t name_offset = decode_uint32(p);
+		action.deadzone = decode_float(p + 4);
+		action.first_event = decode_uint32(p + 8);
+		action.event_count = decode_uint32(p + 12);
+		if (name_offset >= names_size || uint64_t(action.first_event) + action.event_count > event_count) {
+			clear();
+			return ERR_FILE_CORRUPT;
+		}
+		action.name = StringName(String::utf8(names + name_offset));
+		action_indices[action.name] = i;
+	}
+
+	for (uint32_t i = 0; i < event_count; i++, p += EVENT_RECORD_SIZE) {
+		Event &e = events[i];
+		e.key = decode_uint64(p);
+		e.action = decode_uint32(p + 8);
+		e.device = int32_t(decode_uint32(p + 12));
+		e.code = decode_uint32(p + 16);
+		e.unicode = decode_uint32(p + 20);
+		e.modifiers = decode_uint32(p + 24);
+		e.axis_value = decode_float(p + 28);
+		if (e.action >= action_count || p[32] > EVENT_JOY_MOTION) {
+			clear();
+			return ERR_FILE_CORRUPT;
+		}
+		e.type = EventType(p[32]);
+		e.flags = p[33];
+	}
+
+	_index_events();
+	return OK;
+}
+
+void CompiledInputMap::clear() {
+	actions.clear();
+	events.clear();
+	action_indices.clear();
+	event_lookup.clear();
+}
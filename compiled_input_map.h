@@ -0,0 +1,87 @@
+#ifndef COMPILED_INPUT_MAP_H
+#define COMPILED_INPUT_MAP_H
+
+#include "core/input/input_event.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+
+// Flat form of the "input/" project settings: actions and their events in two arrays,
+// plus a table from a prehashed event key to the events that use it, so the actions
+// matching an input event are found without walking every action. Built and saved at
+// export time, then loaded with a single read instead of decoding Variant trees.
+class CompiledInputMap {
+public:
+	enum EventType : uint8_t {
+		EVENT_KEY,
+		EVENT_PHYSICAL_KEY,
+		EVENT_KEY_LABEL,
+		EVENT_MOUSE_BUTTON,
+		EVENT_JOY_BUTTON,
+		EVENT_JOY_MOTION,
+	};
+
+	struct Action {
+		StringName name;
+		float deadzone = 0.5;
+		uint32_t first_event = 0;
+		uint32_t event_count = 0;
+	};
+
+	struct Event {
+		uint64_t key = 0;
+		uint32_t action = 0;
+		int32_t device = 0;
+		uint32_t code = 0; // Keycode, physical keycode, key label, button index or axis.
+		uint32_t unicode = 0;
+		uint32_t modifiers = 0;
+		float axis_value = 0;
+		EventType type = EVENT_KEY;
+		uint8_t flags = 0;
+	};
+
+private:
+	static constexpr uint32_t MAGIC = 0x4D494447; // "GDIM"
+	static constexpr uint32_t VERSION = 2;
+	static constexpr uint32_t HEADER_SIZE = 7 * sizeof(uint32_t);
+	static constexpr uint32_t ACTION_RECORD_SIZE = 4 * sizeof(uint32_t);
+	static constexpr uint32_t EVENT_RECORD_SIZE = sizeof(uint64_t) + 6 * sizeof(uint32_t) + 4;
+
+	enum {
+		FLAG_COMMAND_OR_CONTROL_AUTOREMAP = 1,
+		FLAG_DOUBLE_CLICK = 2,
+	};
+
+	LocalVector<Action> actions;
+	LocalVector<Event> events;
+	HashMap<StringName, uint32_t> action_indices;
+	HashMap<uint64_t, LocalVector<uint32_t>> event_lookup;
+
+	static uint64_t _make_key(EventType p_type, uint32_t p_code, uint32_t p_modifiers);
+	static uint32_t _get_joy_motion_code(JoyAxis p_axis, float p_value);
+	static bool _compile_event(const Ref<InputEvent> &p_event, Event &r_event);
+	void _lookup(EventType p_type, uint32_t p_code, uint32_t p_modifiers, int p_device, bool p_exact_match, LocalVector<uint32_t> &r_actions) const;
+	void _index_events();
+
+public:
+	void add_action(const StringName &p_name, float p_deadzone, const Array &p_events);
+
+	uint32_t get_action_count() const { return actions.size(); }
+	const Action &get_action(uint32_t p_index) const { return actions[p_index]; }
+	int get_action_index(const StringName &p_name) const;
+	const Event &get_event(uint32_t p_index) const { return events[p_index]; }
+	Ref<InputEvent> create_event(uint32_t p_index) const;
+
+	// Indices of the actions with an event matching p_event, by the same rules as
+	// InputEvent::action_match(), for the event's device or all devices. Joypad motion
+	// matches the actions of both directions of the axis (so the opposite one can be
+	// released); computing pressed and strength, deadzones included, is left to the caller.
+	void get_actions_for_event(const Ref<InputEvent> &p_event, LocalVector<uint32_t> &r_actions, bool p_exact_match = false) const;
+
+	// p_source_hash identifies the settings the map was compiled from; loading fails
+	// if it doesn't match the current ones.
+	Error save(const String &p_path, uint32_t p_source_hash) const;
+	Error load(const String &p_path, uint32_t p_source_hash);
+	void clear();
+};
+
+#endif // COMPILED_INPUT_MAP_H
@@ -0,0 +1,34 @@
+#ifndef DOUBLE_BUFFERED_STATE_H
+#define DOUBLE_BUFFERED_STATE_H
+
+#include "core/os/mutex.h"
+
+// Hands state over from one producer thread (e.g. the physics thread) to consumers.
+// The producer writes into the back buffer without locking and publishes it; consumers
+// get a copy of the last published state. The lock is only held to flip or copy.
+template <typename T>
+class DoubleBufferedState {
+	T buffers[2];
+	uint32_t front = 0;
+	mutable BinaryMutex mutex;
+
+public:
+	// Producer only.
+	_FORCE_INLINE_ T &get_back() { return buffers[front ^ 1]; }
+
+	// Producer only. The new back buffer starts as a copy of what was just published.
+	void publish() {
+		{
+			MutexLock lock(mutex);
+			front ^= 1;
+		}
+		buffers[front ^ 1] = buffers[front];
+	}
+
+	T read() const {
+		MutexLock lock(mutex);
+		return buffers[front];
+	}
+};
+
+#endif // DOUBLE_BUFFERED_STATE_H
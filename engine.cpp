@@ -4,11 +4,14 @@
 #include "core/config/project_settings.h"
 #include "core/donors.gen.h"
 #include "core/license.gen.h"
+#include "core/os/os.h"
+#include "core/os/thread.h"
 #include "core/variant/typed_array.h"
 #include "core/version.h"
 
 void Engine::set_physics_ticks_per_second(int p_ips) {
 	ERR_FAIL_COND_MSG(p_ips <= 0, "Engine iterations per second must be greater than 0.");
+	MutexLock lock(physics_step_mutex);
 	ips = p_ips;
 }
 
@@ -18,10 +21,15 @@ int Engine::get_physics_ticks_per_second() const {
 
 void Engine::set_max_physics_steps_per_frame(int p_max_physics_steps) {
 	ERR_FAIL_COND_MSG(p_max_physics_steps <= 0, "Maximum number of physics steps per frame must be greater than 0.");
-	max_physics_steps_per_frame = p_max_physics_steps;
+	{
+		MutexLock lock(physics_step_mutex);
+		max_physics_steps_per_frame = p_max_physics_steps;
+	}
+	_update_physics_stats_window();
 }
 
 int Engine::get_max_physics_steps_per_frame() const {
+	MutexLock lock(physics_step_mutex);
 	return max_physics_steps_per_frame;
 }
 
@@ -36,8 +44,201 @@ double Engine::get_physics_jitter_fix() const {
 	return physics_jitter_fix;
 }
 
+void Engine::set_physics_step_mode(PhysicsStepScheduler::Mode p_mode) {
+	MutexLock lock(physics_step_mutex);
+	physics_step_scheduler.set_mode(p_mode);
+}
+
+PhysicsStepScheduler::Mode Engine::get_physics_step_mode() const {
+	MutexLock lock(physics_step_mutex);
+	return physics_step_scheduler.get_mode();
+}
+
+void Engine::set_max_physics_step_debt(int p_steps) {
+	MutexLock lock(physics_step_mutex);
+	physics_step_scheduler.set_max_debt_steps(p_steps);
+}
+
+int Engine::get_max_physics_step_debt() const {
+	MutexLock lock(physics_step_mutex);
+	return physics_step_scheduler.get_max_debt_steps();
+}
+
+void Engine::set_physics_catch_up_frames(int p_frames) {
+	MutexLock lock(physics_step_mutex);
+	physics_step_scheduler.set_catch_up_frames(p_frames);
+}
+
+int Engine::get_physics_catch_up_frames() const {
+	MutexLock lock(physics_step_mutex);
+	return physics_step_scheduler.get_catch_up_frames();
+}
+
+void Engine::set_min_adaptive_physics_ticks_per_second(int p_ips) {
+	MutexLock lock(physics_step_mutex);
+	physics_step_scheduler.set_min_adaptive_ips(p_ips);
+}
+
+int Engine::get_min_adaptive_physics_ticks_per_second() const {
+	MutexLock lock(physics_step_mutex);
+	return physics_step_scheduler.get_min_adaptive_ips();
+}
+
+// Called by Main with the number of physics steps due this frame, before applying
+// max_physics_steps_per_frame. Returns the number of steps to actually run.
+int Engine::schedule_physics_steps(int p_due_steps) {
+	MutexLock lock(physics_step_mutex);
+	return physics_step_scheduler.schedule(p_due_steps, max_physics_steps_per_frame, ips);
+}
+
+// Tick rate the main loop should step physics at. Lower than the configured one only
+// while the adaptive step mode is backing off.
+int Engine::get_effective_physics_ticks_per_second() const {
+	MutexLock lock(physics_step_mutex);
+	return physics_step_scheduler.get_effective_ips(ips);
+}
+
+int Engine::get_physics_step_debt() const {
+	MutexLock lock(physics_step_mutex);
+	return physics_step_scheduler.get_debt_steps();
+}
+
+double Engine::get_physics_dropped_time() const {
+	MutexLock lock(physics_step_mutex);
+	return physics_step_scheduler.get_dropped_time();
+}
+
+Dictionary Engine::get_physics_step_stats() const {
+	MutexLock lock(physics_step_mutex);
+	return physics_step_scheduler.get_stats(ips);
+}
+
+// Main calls this at the very start of an iteration. Input, audio and network code
+// should timestamp against the frame clock instead of querying the OS clock themselves.
+void Engine::notify_frame_start() {
+	frame_clock_frame_start.set(FramePacer::get_ticks_nsec());
+}
+
+void Engine::notify_physics_step_start() {
+	frame_clock_physics_step_length.set(1000000000 / uint64_t(get_effective_physics_ticks_per_second()));
+	frame_clock_physics_step_start.set(FramePacer::get_ticks_nsec());
+}
+
+uint64_t Engine::get_nsec_since_frame_start() const {
+	uint64_t start = frame_clock_frame_start.get();
+	uint64_t now = FramePacer::get_ticks_nsec();
+	return now > start ? now - start : 0;
+}
+
+// Fraction of a physics step elapsed since the last physics step started, as of now.
+double Engine::get_frame_clock_interpolation_fraction() const {
+	uint64_t start = frame_clock_physics_step_start.get();
+	uint64_t length = frame_clock_physics_step_length.get();
+	uint64_t now = FramePacer::get_ticks_nsec();
+	if (length == 0 || now <= start) {
+		return 0.0;
+	}
+	return MIN(1.0, double(now - start) / length);
+}
+
+// Time scale for code running on the physics thread.
+double Engine::_get_physics_time_scale() const {
+	MutexLock lock(physics_step_mutex);
+	return _time_scale;
+}
+
+void Engine::_physics_thread_func(void *p_engine) {
+	Engine *engine = static_cast<Engine *>(p_engine);
+	FramePacer timer;
+	uint64_t next_tick_nsec = FramePacer::get_ticks_nsec();
+
+	while (engine->physics_thread_running.is_set()) {
+		uint64_t step_nsec = 1000000000 / uint64_t(engine->get_effective_physics_ticks_per_second());
+		next_tick_nsec += step_nsec;
+		timer.sleep_until(next_tick_nsec);
+
+		// If we woke up late (or the previous steps were slow), several ticks are due.
+		uint64_t now = FramePacer::get_ticks_nsec();
+		int due_steps = 1 + int((now - next_tick_nsec) / step_nsec);
+		next_tick_nsec += uint64_t(due_steps - 1) * step_nsec;
+
+		int steps = engine->schedule_physics_steps(due_steps);
+		double step = step_nsec / 1000000000.0 * engine->_get_physics_time_scale();
+
+		PhysicsThreadState &state = engine->physics_thread_state.get_back();
+		for (int i = 0; i < steps; i++) {
+			engine->notify_physics_step_start();
+			engine->physics_thread_step_caller.set(Thread::get_caller_id());
+			engine->physics_thread_step_func(step, engine->physics_thread_userdata);
+			engine->physics_thread_step_caller.set(Thread::UNASSIGNED_ID);
+			state.physics_frames++;
+		}
+		state.tick_nsec = next_tick_nsec;
+		state.step_nsec = step_nsec;
+		engine->physics_thread_state.publish();
+	}
+}
+
+// Runs physics on its own thread at the physics tick rate instead of interleaving
+// steps with process on the main loop. The step function is called on that thread,
+// and state for process should be handed over through a DoubleBufferedState.
+Error Engine::start_physics_thread(PhysicsThreadStepFunc p_step_func, void *p_userdata) {
+	ERR_FAIL_NULL_V(p_step_func, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V_MSG(physics_thread_running.is_set(), ERR_ALREADY_IN_USE, "Physics thread is already running.");
+
+	physics_thread_step_func = p_step_func;
+	physics_thread_userdata = p_userdata;
+
+	PhysicsThreadState &state = physics_thread_state.get_back();
+	state.physics_frames = _physics_frames;
+	state.tick_nsec = FramePacer::get_ticks_nsec();
+	state.step_nsec = 1000000000 / uint64_t(ips);
+	physics_thread_state.publish();
+
+	physics_thread_running.set();
+	physics_thread.start(&Engine::_physics_thread_func, this);
+	return OK;
+}
+
+void Engine::stop_physics_thread() {
+	if (!physics_thread_running.is_set()) {
+		return;
+	}
+	physics_thread_running.clear();
+	physics_thread.wait_to_finish();
+	_physics_frames = physics_thread_state.read().physics_frames;
+}
+
+uint64_t Engine::get_physics_frames() const {
+	if (physics_thread_running.is_set()) {
+		return physics_thread_state.read().physics_frames;
+	}
+	return _physics_frames;
+}
+
+bool Engine::is_in_physics_frame() const {
+	if (physics_thread_running.is_set()) {
+		return physics_thread_step_caller.get() == Thread::get_caller_id();
+	}
+	return _in_physics;
+}
+
+// How far process is between the last published physics tick and the next one.
+double Engine::get_physics_thread_interpolation_fraction() const {
+	if (!physics_thread_running.is_set()) {
+		return _physics_interpolation_fraction;
+	}
+	PhysicsThreadState state = physics_thread_state.read();
+	uint64_t now = FramePacer::get_ticks_nsec();
+	if (state.step_nsec == 0 || now <= state.tick_nsec) {
+		return 0.0;
+	}
+	return MIN(1.0, double(now - state.tick_nsec) / state.step_nsec);
+}
+
 void Engine::set_max_fps(int p_fps) {
 	_max_fps = p_fps > 0 ? p_fps : 0;
+	frame_pacer.set_target_fps(_max_fps);
 }
 
 int Engine::get_max_fps() const {
@@ -46,13 +247,45 @@ int Engine::get_max_fps() const {
 
 void Engine::set_audio_output_latency(int p_msec) {
 	_audio_output_latency = p_msec > 1 ? p_msec : 1;
+	audio_frame_sync.set_output_latency(uint64_t(_audio_output_latency) * 1000000);
 }
 
 int Engine::get_audio_output_latency() const {
 	return _audio_output_latency;
 }
 
+// In low latency mode, frames start just in time to be finished right before the next
+// audio buffer is pulled, instead of as soon as the frame rate cap allows. This keeps
+// the input-to-output latency low for rhythm and MIDI driven applications.
+void Engine::set_low_latency_audio_sync_enabled(bool p_enabled) {
+	low_latency_audio_sync = p_enabled;
+	audio_frame_sync.reset();
+}
+
+// Called by the audio driver from its thread each time it mixes a buffer.
+void Engine::notify_audio_callback(int p_frames, int p_mix_rate) {
+	audio_frame_sync.notify_callback(FramePacer::get_ticks_nsec(), p_frames, p_mix_rate);
+}
+
+Dictionary Engine::get_audio_sync_stats() const {
+	Dictionary stats = audio_frame_sync.get_stats();
+	stats["enabled"] = low_latency_audio_sync;
+	stats["configured_output_latency"] = _audio_output_latency;
+	return stats;
+}
+
 void Engine::increment_frames_drawn() {
+	MutexLock lock(server_sync_mutex);
+
+	uint64_t now = FramePacer::get_ticks_nsec();
+	server_sync_window_wait_nsec[server_sync_window_pos] = server_sync_frame_wait_nsec;
+	server_sync_window_frame_nsec[server_sync_window_pos] = server_sync_last_frame_nsec > 0 ? now - server_sync_last_frame_nsec : 0;
+	server_sync_window_synced[server_sync_window_pos] = frame_server_synced;
+	server_sync_window_pos = (server_sync_window_pos + 1) % SERVER_SYNC_STATS_WINDOW;
+	server_sync_window_size = MIN(server_sync_window_size + 1, SERVER_SYNC_STATS_WINDOW);
+	server_sync_frame_wait_nsec = 0;
+	server_sync_last_frame_nsec = now;
+
 	if (frame_server_synced) {
 		server_syncs++;
 	} else {
@@ -75,7 +308,248 @@ uint32_t Engine::get_frame_delay() const {
 	return _frame_delay;
 }
 
+// In lockstep mode the clock advances by a fixed amount per frame, independent of wall
+// time, and frames run back to back. Physics steps are counted with integer arithmetic
+// so a run is bit-reproducible from the frame counters alone.
+void Engine::set_lockstep_enabled(bool p_enabled) {
+	if (p_enabled == lockstep_enabled) {
+		return;
+	}
+
+	if (lockstep_enabled && lockstep_frames > 0) {
+		Dictionary stats = get_lockstep_stats();
+		print_verbose(vformat("Lockstep: %d frames, %.3f simulated seconds in %.3f wall seconds (%.2f simulated seconds per wall second).",
+				lockstep_frames, stats["simulated_time"], stats["wall_time"], stats["simulated_seconds_per_wall_second"]));
+	}
+
+	lockstep_enabled = p_enabled;
+	lockstep_accum = 0;
+	lockstep_frames = 0;
+	lockstep_simulated_time = 0.0;
+	lockstep_begin_usec = OS::get_singleton()->get_ticks_usec();
+}
+
+void Engine::set_lockstep_frames_per_second(int p_fps) {
+	ERR_FAIL_COND_MSG(p_fps <= 0, "Lockstep frames per second must be greater than 0.");
+	lockstep_fps = p_fps;
+	lockstep_accum = 0;
+}
+
+int Engine::get_lockstep_frames_per_second() const {
+	return lockstep_fps;
+}
+
+// Called by Main instead of its timer when lockstep is enabled. Updates the process
+// step and interpolation fraction, and returns how many physics steps to run.
+int Engine::advance_lockstep_frame() {
+	ERR_FAIL_COND_V(!lockstep_enabled, 0);
+
+	// Each frame adds 1 / lockstep_fps seconds, i.e. ips units; each physics step
+	// consumes 1 / ips seconds, i.e. lockstep_fps units.
+	lockstep_accum += uint64_t(ips);
+	int steps = int(lockstep_accum / uint64_t(lockstep_fps));
+	lockstep_accum %= uint64_t(lockstep_fps);
+
+	_process_step = 1.0 / lockstep_fps;
+	_physics_interpolation_fraction = double(lockstep_accum) / lockstep_fps;
+	lockstep_frames++;
+	_frame_ticks = lockstep_frames * 1000000 / uint64_t(lockstep_fps);
+	lockstep_simulated_time += _process_step * _time_scale;
+
+	return steps;
+}
+
+Dictionary Engine::get_lockstep_stats() const {
+	double wall_time = (OS::get_singleton()->get_ticks_usec() - lockstep_begin_usec) / 1000000.0;
+
+	Dictionary stats;
+	stats["frames"] = lockstep_frames;
+	stats["simulated_time"] = lockstep_simulated_time;
+	stats["wall_time"] = wall_time;
+	stats["simulated_seconds_per_wall_second"] = wall_time > 0.0 ? lockstep_simulated_time / wall_time : 0.0;
+	return stats;
+}
+
+// In idle mode the main loop doesn't iterate unless something asks for it: it blocks in
+// wait_for_wake() until an event source calls request_wake() or a timer is due.
+void Engine::set_idle_mode_enabled(bool p_enabled) {
+	idle_mode = p_enabled;
+	if (!idle_mode) {
+		// Don't leave the main loop blocked.
+		idle_waiter.post(WAKE_REASON_PROCESS);
+	}
+}
+
+// Safe to call from any thread.
+void Engine::request_wake(WakeReason p_reason) {
+	idle_waiter.post(p_reason);
+}
+
+// Called by Main instead of iterating when idle mode is enabled. Returns the mask of
+// WakeReason that caused the wake-up.
+uint32_t Engine::wait_for_wake() {
+	if (!idle_mode || lockstep_enabled) {
+		return WAKE_REASON_PROCESS;
+	}
+
+	// Sleep until the earliest timer, converting its scaled delay back to wall time.
+	int64_t timeout_usec = -1;
+	if (_time_scale > 0.0) {
+		double process_timer = process_timers.get_time_to_next_timer();
+		double physics_timer;
+		{
+			MutexLock lock(physics_timers_mutex);
+			physics_timer = physics_timers.get_time_to_next_timer();
+		}
+		double next_timer = process_timer < 0.0 ? physics_timer : (physics_timer < 0.0 ? process_timer : MIN(process_timer, physics_timer));
+		if (next_timer >= 0.0) {
+			timeout_usec = int64_t(next_timer / _time_scale * 1000000.0);
+		}
+	}
+
+	uint64_t begin = OS::get_singleton()->get_ticks_usec();
+	uint32_t reasons = idle_waiter.wait(timeout_usec);
+	if (reasons == 0) {
+		reasons = WAKE_REASON_TIMER;
+	}
+
+	idle_waits++;
+	idle_time_usec += OS::get_singleton()->get_ticks_usec() - begin;
+	for (int i = 0; i < WAKE_REASON_COUNT; i++) {
+		if (reasons & (1 << i)) {
+			idle_wakeups[i]++;
+		}
+	}
+	return reasons;
+}
+
+Dictionary Engine::get_idle_stats() const {
+	static const char *reason_names[WAKE_REASON_COUNT] = {
+		"redraw",
+		"process",
+		"input",
+		"network",
+		"file_changed",
+		"timer",
+	};
+
+	Dictionary wakeups;
+	for (int i = 0; i < WAKE_REASON_COUNT; i++) {
+		wakeups[reason_names[i]] = idle_wakeups[i];
+	}
+
+	Dictionary stats;
+	stats["enabled"] = idle_mode;
+	stats["waits"] = idle_waits;
+	stats["idle_time"] = idle_time_usec / 1000000.0;
+	stats["wakeups"] = wakeups;
+	return stats;
+}
+
+// Called by Main once per iteration, instead of relying on coarse sleeps to honor
+// max FPS and frame delay.
+void Engine::pace_frame() {
+	if (lockstep_enabled) {
+		// Maximum throughput, no sleeping at all.
+		return;
+	}
+
+	if (low_latency_audio_sync) {
+		audio_frame_sync.notify_frame_end(FramePacer::get_ticks_nsec(), frame_clock_frame_start.get());
+	}
+
+	frame_pacer.wait_for_next_frame(_frame_delay, low_latency_audio_sync ? &audio_frame_sync : nullptr);
+}
+
+Dictionary Engine::get_frame_pacing_stats() const {
+	return frame_pacer.get_stats();
+}
+
+void Engine::reset_frame_pacing_stats() {
+	frame_pacer.reset_stats();
+}
+
+void Engine::record_frame_time(uint64_t p_frame_usec, uint64_t p_process_usec) {
+	frame_time_histogram.record(p_frame_usec);
+	process_step_histogram.record(p_process_usec);
+}
+
+// Called from the physics thread, which may run while the main thread resizes the window.
+void Engine::record_physics_step_time(uint64_t p_usec) {
+	MutexLock lock(physics_step_mutex);
+	physics_step_histogram.record(p_usec);
+}
+
+void Engine::set_frame_stats_window(int p_frames) {
+	ERR_FAIL_COND_MSG(p_frames < int(FrameTimeHistogram::WINDOW_SLICES), vformat("Frame statistics window must be at least %d frames.", FrameTimeHistogram::WINDOW_SLICES));
+	frame_time_histogram.set_window_size(p_frames);
+	process_step_histogram.set_window_size(p_frames);
+	_update_physics_stats_window();
+}
+
+// Several physics steps may run per frame, but the window is still expressed in frames.
+void Engine::_update_physics_stats_window() {
+	MutexLock lock(physics_step_mutex);
+	physics_step_histogram.set_window_size(frame_time_histogram.get_window_size() * max_physics_steps_per_frame);
+}
+
+int Engine::get_frame_stats_window() const {
+	return frame_time_histogram.get_window_size();
+}
+
+// Returns the frame time (in milliseconds) below which the given percentage of the
+// frames in the statistics window fall.
+double Engine::get_frame_time_percentile(double p_percentile) const {
+	return frame_time_histogram.get_percentile(p_percentile) / 1000.0;
+}
+
+Dictionary Engine::get_frame_stats() const {
+	Dictionary stats;
+	stats["frame"] = frame_time_histogram.get_stats();
+	stats["process"] = process_step_histogram.get_stats();
+	{
+		MutexLock lock(physics_step_mutex);
+		stats["physics"] = physics_step_histogram.get_stats();
+	}
+	return stats;
+}
+
+void Engine::clear_frame_stats() {
+	frame_time_histogram.clear();
+	process_step_histogram.clear();
+
+	MutexLock lock(physics_step_mutex);
+	physics_step_histogram.clear();
+}
+
+// A size of 0 disables phase recording, which is the default.
+void Engine::set_frame_phase_history_size(int p_frames) {
+	ERR_FAIL_COND_MSG(p_frames < 0, "Frame phase history size can't be negative.");
+	frame_phase_recorder.set_history_size(p_frames);
+}
+
+int Engine::get_frame_phase_history_size() const {
+	return frame_phase_recorder.get_history_size();
+}
+
+void Engine::begin_frame_phases() {
+	frame_phase_recorder.begin_frame(_process_frames);
+}
+
+void Engine::end_frame_phases() {
+	frame_phase_recorder.end_frame();
+}
+
+Array Engine::get_frame_phase_history() const {
+	return frame_phase_recorder.get_history();
+}
+
+Error Engine::dump_frame_phase_trace(const String &p_path) const {
+	return frame_phase_recorder.dump_chrome_trace(p_path);
+}
+
 void Engine::set_time_scale(double p_scale) {
+	MutexLock lock(physics_step_mutex);
 	_time_scale = p_scale;
 }
 
@@ -83,6 +557,63 @@ double Engine::get_time_scale() const {
 	return _time_scale;
 }
 
+static constexpr uint64_t PHYSICS_TIMER_ID_TAG = uint64_t(1) << 63;
+
+// Timer delays are in scaled seconds: process timers follow the scaled process step
+// and physics timers the scaled physics step.
+uint64_t Engine::schedule_timer(double p_delay, const Callable &p_callable, bool p_physics) {
+	if (p_physics) {
+		MutexLock lock(physics_timers_mutex);
+		return physics_timers.schedule(p_delay, p_callable);
+	}
+	return process_timers.schedule(p_delay, p_callable);
+}
+
+uint64_t Engine::schedule_timer(double p_delay, TimerWheel::Callback p_callback, void *p_userdata, bool p_physics) {
+	if (p_physics) {
+		MutexLock lock(physics_timers_mutex);
+		return physics_timers.schedule(p_delay, p_callback, p_userdata);
+	}
+	return process_timers.schedule(p_delay, p_callback, p_userdata);
+}
+
+bool Engine::cancel_timer(uint64_t p_timer_id) {
+	if (p_timer_id & PHYSICS_TIMER_ID_TAG) {
+		MutexLock lock(physics_timers_mutex);
+		return physics_timers.cancel(p_timer_id);
+	}
+	return process_timers.cancel(p_timer_id);
+}
+
+bool Engine::is_timer_pending(uint64_t p_timer_id) const {
+	if (p_timer_id & PHYSICS_TIMER_ID_TAG) {
+		MutexLock lock(physics_timers_mutex);
+		return physics_timers.is_pending(p_timer_id);
+	}
+	return process_timers.is_pending(p_timer_id);
+}
+
+// Called by Main once per process frame, after the process step is known.
+void Engine::advance_process_timers() {
+	process_timers.advance(_process_step * _time_scale);
+}
+
+// Called by Main once per physics step.
+void Engine::advance_physics_timers() {
+	MutexLock lock(physics_timers_mutex);
+	physics_timers.advance(_get_physics_time_scale() / get_effective_physics_ticks_per_second());
+}
+
+Dictionary Engine::get_timer_stats() const {
+	Dictionary stats;
+	stats["process_pending"] = process_timers.get_pending_count();
+	stats["process_fired"] = process_timers.get_fired_count();
+	MutexLock lock(physics_timers_mutex);
+	stats["physics_pending"] = physics_timers.get_pending_count();
+	stats["physics_fired"] = physics_timers.get_fired_count();
+	return stats;
+}
+
 Dictionary Engine::get_version_info() const {
 	Dictionary dict;
 	dict["major"] = VERSION_MAJOR;
@@ -261,6 +792,9 @@ void Engine::add_singleton(const Singleton &p_singleton) {
 
 Object *Engine::get_singleton_object(const StringName &p_name) const {
 	HashMap<StringName, Object *>::ConstIterator E = singleton_ptrs.find(p_name);
+	if (!E && parent_engine) {
+		return parent_engine->get_singleton_object(p_name);
+	}
 	ERR_FAIL_COND_V_MSG(!E, nullptr, vformat("Failed to retrieve non-existent singleton '%s'.", p_name));
 
 #ifdef TOOLS_ENABLED
@@ -273,6 +807,9 @@ Object *Engine::get_singleton_object(const StringName &p_name) const {
 }
 
 bool Engine::is_singleton_user_created(const StringName &p_name) const {
+	if (!singleton_ptrs.has(p_name) && parent_engine) {
+		return parent_engine->is_singleton_user_created(p_name);
+	}
 	ERR_FAIL_COND_V(!singleton_ptrs.has(p_name), false);
 
 	for (const Singleton &E : singletons) {
@@ -285,6 +822,9 @@ bool Engine::is_singleton_user_created(const StringName &p_name) const {
 }
 
 bool Engine::is_singleton_editor_only(const StringName &p_name) const {
+	if (!singleton_ptrs.has(p_name) && parent_engine) {
+		return parent_engine->is_singleton_editor_only(p_name);
+	}
 	ERR_FAIL_COND_V(!singleton_ptrs.has(p_name), false);
 
 	for (const Singleton &E : singletons) {
@@ -309,7 +849,7 @@ void Engine::remove_singleton(const StringName &p_name) {
 }
 
 bool Engine::has_singleton(const StringName &p_name) const {
-	return singleton_ptrs.has(p_name);
+	return singleton_ptrs.has(p_name) || (parent_engine && parent_engine->has_singleton(p_name));
 }
 
 void Engine::get_singletons(List<Singleton> *p_singletons) {
@@ -322,6 +862,16 @@ void Engine::get_singletons(List<Singleton> *p_singletons) {
 
 		p_singletons->push_back(E);
 	}
+
+	if (parent_engine) {
+		List<Singleton> parent_singletons;
+		parent_engine->get_singletons(&parent_singletons);
+		for (const Singleton &E : parent_singletons) {
+			if (!singleton_ptrs.has(E.name)) {
+				p_singletons->push_back(E);
+			}
+		}
+	}
 }
 
 String Engine::get_write_movie_path() const {
@@ -340,21 +890,110 @@ String Engine::get_shader_cache_path() const {
 }
 
 Engine *Engine::singleton = nullptr;
+thread_local Engine *Engine::context_singleton = nullptr;
 
 Engine *Engine::get_singleton() {
-	return singleton;
+	// An EngineContext made current on this thread takes precedence over the process one.
+	return context_singleton ? context_singleton : singleton;
 }
 
 bool Engine::notify_frame_server_synced() {
+	MutexLock lock(server_sync_mutex);
 	frame_server_synced = true;
 	return server_syncs > SERVER_SYNC_FRAME_COUNT_WARNING;
 }
 
+bool Engine::notify_frame_server_synced(const StringName &p_requester, uint64_t p_wait_usec) {
+	MutexLock lock(server_sync_mutex);
+
+	uint64_t wait_nsec = p_wait_usec * 1000;
+	ServerSyncRequesterStats &stats = server_sync_requesters[p_requester];
+	stats.syncs++;
+	stats.total_wait_nsec += wait_nsec;
+	stats.max_wait_nsec = MAX(stats.max_wait_nsec, wait_nsec);
+	server_sync_frame_wait_nsec += wait_nsec;
+
+	frame_server_synced = true;
+	return server_syncs > SERVER_SYNC_FRAME_COUNT_WARNING;
+}
+
+Dictionary Engine::get_server_sync_stats() const {
+	MutexLock lock(server_sync_mutex);
+
+	uint64_t window_wait_nsec = 0;
+	uint64_t window_frame_nsec = 0;
+	int window_synced_frames = 0;
+	for (int i = 0; i < server_sync_window_size; i++) {
+		window_wait_nsec += server_sync_window_wait_nsec[i];
+		window_frame_nsec += server_sync_window_frame_nsec[i];
+		window_synced_frames += server_sync_window_synced[i] ? 1 : 0;
+	}
+
+	Dictionary stats;
+	stats["consecutive_synced_frames"] = server_syncs;
+	stats["window_frames"] = server_sync_window_size;
+	stats["window_synced_frames"] = window_synced_frames;
+	stats["window_wait_time"] = window_wait_nsec / 1000000.0;
+	// Share of wall time the frame spent blocked, i.e. parallelism lost to forced syncs.
+	stats["window_wait_ratio"] = window_frame_nsec > 0 ? double(window_wait_nsec) / window_frame_nsec : 0.0;
+
+	Dictionary requesters;
+	for (const KeyValue<StringName, ServerSyncRequesterStats> &E : server_sync_requesters) {
+		Dictionary requester;
+		requester["syncs"] = E.value.syncs;
+		requester["total_wait_time"] = E.value.total_wait_nsec / 1000000.0;
+		requester["max_wait_time"] = E.value.max_wait_nsec / 1000000.0;
+		requester["avg_wait_time"] = E.value.total_wait_nsec / 1000000.0 / E.value.syncs;
+		requesters[E.key] = requester;
+	}
+	stats["requesters"] = requesters;
+
+	return stats;
+}
+
+void Engine::clear_server_sync_stats() {
+	MutexLock lock(server_sync_mutex);
+	server_sync_requesters.clear();
+	server_sync_window_pos = 0;
+	server_sync_window_size = 0;
+	server_sync_frame_wait_nsec = 0;
+}
+
+Engine::ServerSyncScope::ServerSyncScope(const StringName &p_requester, bool *r_sync_warning) :
+		requester(p_requester),
+		r_warn(r_sync_warning) {
+	begin_nsec = FramePacer::get_ticks_nsec();
+	if (Thread::is_main_thread()) {
+		Engine::get_singleton()->begin_frame_phase(FramePhaseRecorder::PHASE_SERVER_SYNC);
+	}
+}
+
+Engine::ServerSyncScope::~ServerSyncScope() {
+	Engine *engine = Engine::get_singleton();
+	if (Thread::is_main_thread()) {
+		engine->end_frame_phase(FramePhaseRecorder::PHASE_SERVER_SYNC);
+	}
+	bool warn = engine->notify_frame_server_synced(requester, (FramePacer::get_ticks_nsec() - begin_nsec) / 1000);
+	if (r_warn) {
+		*r_warn = warn;
+	}
+}
+
 Engine::Engine() {
 	singleton = this;
+	physics_timers.set_id_tag(PHYSICS_TIMER_ID_TAG);
+}
+
+// Engine of an EngineContext. It never becomes the process singleton, and shares the
+// singletons (servers, Input...) registered in p_parent.
+Engine::Engine(Engine *p_parent) :
+		parent_engine(p_parent) {
+	physics_timers.set_id_tag(PHYSICS_TIMER_ID_TAG);
 }
 
 Engine::~Engine() {
+	stop_physics_thread();
+
 	if (singleton == this) {
 		singleton = nullptr;
 	}
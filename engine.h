@@ -1,9 +1,20 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include "core/config/audio_frame_sync.h"
+#include "core/config/double_buffered_state.h"
+#include "core/config/frame_pacer.h"
+#include "core/config/frame_phase_recorder.h"
+#include "core/config/frame_time_histogram.h"
+#include "core/config/idle_waiter.h"
+#include "core/config/physics_step_scheduler.h"
+#include "core/config/timer_wheel.h"
 #include "core/os/main_loop.h"
+#include "core/os/mutex.h"
+#include "core/os/thread.h"
 #include "core/string/ustring.h"
 #include "core/templates/list.h"
+#include "core/templates/safe_refcount.h"
 #include "core/templates/vector.h"
 
 template <typename T>
@@ -11,6 +22,17 @@ class TypedArray;
 
 class Engine {
 public:
+	typedef void (*PhysicsThreadStepFunc)(double p_step, void *p_userdata);
+
+	enum WakeReason {
+		WAKE_REASON_REDRAW = 1 << 0,
+		WAKE_REASON_PROCESS = 1 << 1,
+		WAKE_REASON_INPUT = 1 << 2,
+		WAKE_REASON_NETWORK = 1 << 3,
+		WAKE_REASON_FILE_CHANGED = 1 << 4,
+		WAKE_REASON_TIMER = 1 << 5,
+	};
+
 	struct Singleton {
 		StringName name;
 		Object *ptr = nullptr;
@@ -24,6 +46,7 @@ public:
 
 private:
 	friend class Main;
+	friend class EngineContext;
 
 	uint64_t frames_drawn = 0;
 	uint32_t _frame_delay = 0;
@@ -39,6 +62,11 @@ private:
 	uint64_t _physics_frames = 0;
 	int max_physics_steps_per_frame = 8;
 	double _physics_interpolation_fraction = 0.0f;
+	PhysicsStepScheduler physics_step_scheduler;
+	// Guards the physics step scheduler, ips, max_physics_steps_per_frame, time scale
+	// writes and physics_step_histogram, which the physics thread uses while the main
+	// thread may change them.
+	mutable BinaryMutex physics_step_mutex;
 	bool abort_on_gpu_errors = false;
 	bool use_validation_layers = false;
 	bool generate_spirv_debug_info = false;
@@ -47,8 +75,32 @@ private:
 	uint64_t _process_frames = 0;
 	bool _in_physics = false;
 
+	struct PhysicsThreadState {
+		uint64_t physics_frames = 0;
+		uint64_t tick_nsec = 0;
+		uint64_t step_nsec = 0;
+	};
+
+	Thread physics_thread;
+	SafeFlag physics_thread_running;
+	PhysicsThreadStepFunc physics_thread_step_func = nullptr;
+	void *physics_thread_userdata = nullptr;
+	DoubleBufferedState<PhysicsThreadState> physics_thread_state;
+	SafeNumeric<Thread::ID> physics_thread_step_caller; // Set while a step is running.
+
+	static void _physics_thread_func(void *p_engine);
+	double _get_physics_time_scale() const;
+
+	bool lockstep_enabled = false;
+	int lockstep_fps = 60;
+	uint64_t lockstep_accum = 0; // In units of 1 / (ips * lockstep_fps) seconds.
+	uint64_t lockstep_frames = 0;
+	double lockstep_simulated_time = 0.0;
+	uint64_t lockstep_begin_usec = 0;
+
 	List<Singleton> singletons;
 	HashMap<StringName, Object *> singleton_ptrs;
+	Engine *parent_engine = nullptr; // Singletons not registered here are looked up in it.
 
 	bool editor_hint = false;
 	bool project_manager_hint = false;
@@ -57,6 +109,7 @@ private:
 	bool _print_header = true;
 
 	static Engine *singleton;
+	static thread_local Engine *context_singleton;
 
 	String write_movie_path;
 	String shader_cache_path;
@@ -65,6 +118,55 @@ private:
 	int server_syncs = 0;
 	bool frame_server_synced = false;
 
+	struct ServerSyncRequesterStats {
+		uint64_t syncs = 0;
+		uint64_t total_wait_nsec = 0;
+		uint64_t max_wait_nsec = 0;
+	};
+
+	static constexpr int SERVER_SYNC_STATS_WINDOW = 120;
+	mutable Mutex server_sync_mutex;
+	HashMap<StringName, ServerSyncRequesterStats> server_sync_requesters;
+	uint64_t server_sync_frame_wait_nsec = 0;
+	uint64_t server_sync_window_wait_nsec[SERVER_SYNC_STATS_WINDOW] = {};
+	uint64_t server_sync_window_frame_nsec[SERVER_SYNC_STATS_WINDOW] = {};
+	bool server_sync_window_synced[SERVER_SYNC_STATS_WINDOW] = {};
+	int server_sync_window_pos = 0;
+	int server_sync_window_size = 0;
+	uint64_t server_sync_last_frame_nsec = 0;
+
+	FramePacer frame_pacer;
+
+	bool low_latency_audio_sync = false;
+	AudioFrameSync audio_frame_sync;
+
+	FrameTimeHistogram frame_time_histogram;
+	FrameTimeHistogram process_step_histogram;
+	FrameTimeHistogram physics_step_histogram;
+
+	void _update_physics_stats_window();
+
+	FramePhaseRecorder frame_phase_recorder;
+
+	TimerWheel process_timers;
+	TimerWheel physics_timers;
+	// The physics wheel is advanced on the physics thread when it runs, but scheduled from
+	// any thread. Recursive, so physics timer callbacks can schedule more timers.
+	mutable Mutex physics_timers_mutex;
+
+	static constexpr int WAKE_REASON_COUNT = 6;
+	bool idle_mode = false;
+	IdleWaiter idle_waiter;
+	uint64_t idle_waits = 0;
+	uint64_t idle_time_usec = 0;
+	uint64_t idle_wakeups[WAKE_REASON_COUNT] = {};
+
+	// Frame clock, in monotonic nanoseconds. Written by the main loop (or the physics
+	// thread), readable from any thread without locking.
+	SafeNumeric<uint64_t> frame_clock_frame_start;
+	SafeNumeric<uint64_t> frame_clock_physics_step_start;
+	SafeNumeric<uint64_t> frame_clock_physics_step_length;
+
 public:
 	static Engine *get_singleton();
 
@@ -77,26 +179,67 @@ public:
 	void set_physics_jitter_fix(double p_threshold);
 	double get_physics_jitter_fix() const;
 
+	void set_physics_step_mode(PhysicsStepScheduler::Mode p_mode);
+	PhysicsStepScheduler::Mode get_physics_step_mode() const;
+	void set_max_physics_step_debt(int p_steps);
+	int get_max_physics_step_debt() const;
+	void set_physics_catch_up_frames(int p_frames);
+	int get_physics_catch_up_frames() const;
+	void set_min_adaptive_physics_ticks_per_second(int p_ips);
+	int get_min_adaptive_physics_ticks_per_second() const;
+
+	int schedule_physics_steps(int p_due_steps);
+	int get_effective_physics_ticks_per_second() const;
+	int get_physics_step_debt() const;
+	double get_physics_dropped_time() const;
+	Dictionary get_physics_step_stats() const;
+
+	Error start_physics_thread(PhysicsThreadStepFunc p_step_func, void *p_userdata = nullptr);
+	void stop_physics_thread();
+	bool is_physics_thread_running() const { return physics_thread_running.is_set(); }
+	double get_physics_thread_interpolation_fraction() const;
+
 	virtual void set_max_fps(int p_fps);
 	virtual int get_max_fps() const;
 
 	virtual void set_audio_output_latency(int p_msec);
 	virtual int get_audio_output_latency() const;
 
+	void set_low_latency_audio_sync_enabled(bool p_enabled);
+	bool is_low_latency_audio_sync_enabled() const { return low_latency_audio_sync; }
+	void notify_audio_callback(int p_frames, int p_mix_rate);
+	Dictionary get_audio_sync_stats() const;
+
 	virtual double get_frames_per_second() const { return _fps; }
 
 	uint64_t get_frames_drawn();
 
-	uint64_t get_physics_frames() const { return _physics_frames; }
+	uint64_t get_physics_frames() const;
 	uint64_t get_process_frames() const { return _process_frames; }
-	bool is_in_physics_frame() const { return _in_physics; }
+	bool is_in_physics_frame() const;
 	uint64_t get_frame_ticks() const { return _frame_ticks; }
 	double get_process_step() const { return _process_step; }
 	double get_physics_interpolation_fraction() const { return _physics_interpolation_fraction; }
 
+	void notify_frame_start();
+	void notify_physics_step_start();
+	static uint64_t get_frame_clock_now_nsec() { return FramePacer::get_ticks_nsec(); }
+	uint64_t get_frame_start_nsec() const { return frame_clock_frame_start.get(); }
+	uint64_t get_physics_step_start_nsec() const { return frame_clock_physics_step_start.get(); }
+	uint64_t get_nsec_since_frame_start() const;
+	double get_frame_clock_interpolation_fraction() const;
+
 	void set_time_scale(double p_scale);
 	double get_time_scale() const;
 
+	uint64_t schedule_timer(double p_delay, const Callable &p_callable, bool p_physics = false);
+	uint64_t schedule_timer(double p_delay, TimerWheel::Callback p_callback, void *p_userdata, bool p_physics = false);
+	bool cancel_timer(uint64_t p_timer_id);
+	bool is_timer_pending(uint64_t p_timer_id) const;
+	void advance_process_timers();
+	void advance_physics_timers();
+	Dictionary get_timer_stats() const;
+
 	void set_print_error_messages(bool p_enabled);
 	bool is_printing_error_messages() const;
 	void print_header(const String &p_string) const;
@@ -105,6 +248,42 @@ public:
 	void set_frame_delay(uint32_t p_msec);
 	uint32_t get_frame_delay() const;
 
+	void set_lockstep_enabled(bool p_enabled);
+	bool is_lockstep_enabled() const { return lockstep_enabled; }
+	void set_lockstep_frames_per_second(int p_fps);
+	int get_lockstep_frames_per_second() const;
+	int advance_lockstep_frame();
+	Dictionary get_lockstep_stats() const;
+
+	void set_idle_mode_enabled(bool p_enabled);
+	bool is_idle_mode_enabled() const { return idle_mode; }
+	void request_wake(WakeReason p_reason);
+	void request_redraw() { request_wake(WAKE_REASON_REDRAW); }
+	void request_process() { request_wake(WAKE_REASON_PROCESS); }
+	uint32_t wait_for_wake();
+	Dictionary get_idle_stats() const;
+
+	void pace_frame();
+	Dictionary get_frame_pacing_stats() const;
+	void reset_frame_pacing_stats();
+
+	void record_frame_time(uint64_t p_frame_usec, uint64_t p_process_usec);
+	void record_physics_step_time(uint64_t p_usec);
+	void set_frame_stats_window(int p_frames);
+	int get_frame_stats_window() const;
+	double get_frame_time_percentile(double p_percentile) const;
+	Dictionary get_frame_stats() const;
+	void clear_frame_stats();
+
+	void set_frame_phase_history_size(int p_frames);
+	int get_frame_phase_history_size() const;
+	void begin_frame_phases();
+	void end_frame_phases();
+	_FORCE_INLINE_ void begin_frame_phase(FramePhaseRecorder::Phase p_phase) { frame_phase_recorder.begin_phase(p_phase); }
+	_FORCE_INLINE_ void end_frame_phase(FramePhaseRecorder::Phase p_phase) { frame_phase_recorder.end_phase(p_phase); }
+	Array get_frame_phase_history() const;
+	Error dump_frame_phase_trace(const String &p_path) const;
+
 	void add_singleton(const Singleton &p_singleton);
 	void get_singletons(List<Singleton> *p_singletons);
 	bool has_singleton(const StringName &p_name) const;
@@ -155,8 +334,23 @@ public:
 
 	void increment_frames_drawn();
 	bool notify_frame_server_synced();
+	bool notify_frame_server_synced(const StringName &p_requester, uint64_t p_wait_usec);
+	Dictionary get_server_sync_stats() const;
+	void clear_server_sync_stats();
+
+	// Measures the time spent blocked on a server sync and attributes it to the requester.
+	class ServerSyncScope {
+		StringName requester;
+		uint64_t begin_nsec = 0;
+		bool *r_warn = nullptr;
+
+	public:
+		ServerSyncScope(const StringName &p_requester, bool *r_sync_warning = nullptr);
+		~ServerSyncScope();
+	};
 
 	Engine();
+	explicit Engine(Engine *p_parent);
 	virtual ~Engine();
 };
 
@@ -0,0 +1,53 @@
+#include "engine_context.h"
+
+#include "core/config/engine.h"
+#include "core/config/project_settings.h"
+
+static thread_local EngineContext *current_context = nullptr;
+
+void EngineContext::make_current() {
+	current_context = this;
+	Engine::context_singleton = engine;
+	ProjectSettings::context_singleton = project_settings;
+}
+
+void EngineContext::clear_current() {
+	current_context = nullptr;
+	Engine::context_singleton = nullptr;
+	ProjectSettings::context_singleton = nullptr;
+}
+
+EngineContext *EngineContext::get_current() {
+	return current_context;
+}
+
+EngineContext::Scope::Scope(EngineContext *p_context) {
+	prev_context = current_context;
+	prev_engine = Engine::context_singleton;
+	prev_project_settings = ProjectSettings::context_singleton;
+	current_context = p_context;
+	Engine::context_singleton = p_context->engine;
+	ProjectSettings::context_singleton = p_context->project_settings;
+}
+
+EngineContext::Scope::~Scope() {
+	current_context = prev_context;
+	Engine::context_singleton = prev_engine;
+	ProjectSettings::context_singleton = prev_project_settings;
+}
+
+// Building and tearing down a context never touches the process singletons, so it is
+// safe while other contexts run on their threads.
+EngineContext::EngineContext() {
+	engine = memnew(Engine(Engine::singleton));
+	project_settings = memnew(ProjectSettings(ProjectSettings::singleton));
+}
+
+EngineContext::~EngineContext() {
+	if (current_context == this) {
+		clear_current();
+	}
+
+	memdelete(project_settings);
+	memdelete(engine);
+}
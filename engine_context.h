@@ -0,0 +1,40 @@
+#ifndef ENGINE_CONTEXT_H
+#define ENGINE_CONTEXT_H
+
+#include "core/typedefs.h"
+
+class Engine;
+class ProjectSettings;
+
+// Lets several Engine/ProjectSettings pairs coexist in one process, e.g. one per headless
+// game room. Each context has its own frame counters, time scale and settings, while
+// process-wide immutable data (version info, loaded resource packs) stays shared.
+// Engine::get_singleton() and ProjectSettings::get_singleton() return the context made
+// current on the calling thread, or the process ones if there is none.
+class EngineContext {
+	Engine *engine = nullptr;
+	ProjectSettings *project_settings = nullptr;
+
+public:
+	class Scope {
+		EngineContext *prev_context = nullptr;
+		Engine *prev_engine = nullptr;
+		ProjectSettings *prev_project_settings = nullptr;
+
+	public:
+		Scope(EngineContext *p_context);
+		~Scope();
+	};
+
+	Engine *get_engine() const { return engine; }
+	ProjectSettings *get_project_settings() const { return project_settings; }
+
+	void make_current();
+	static void clear_current();
+	static EngineContext *get_current();
+
+	EngineContext();
+	~EngineContext();
+};
+
+#endif // ENGINE_CONTEXT_H
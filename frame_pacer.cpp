@@ -0,0 +1,167 @@
+#include "frame_pacer.h"
+
+#include "core/math/math_funcs.h"
+#include "core/os/os.h"
+
+#ifdef UNIX_ENABLED
+#include <errno.h>
+#include <time.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+static _FORCE_INLINE_ void _cpu_relax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
+
+uint64_t FramePacer::get_ticks_nsec() {
+#if defined(UNIX_ENABLED) && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000000 + uint64_t(ts.tv_nsec);
+#else
+	return OS::get_singleton()->get_ticks_usec() * 1000;
+#endif
+}
+
+uint64_t FramePacer::_get_spin_margin_nsec() const {
+	// Wake up early enough to cover the typical overshoot plus two deviations of it.
+	double margin = sleep_overshoot_nsec + 2.0 * sleep_overshoot_deviation_nsec;
+	return CLAMP(uint64_t(margin), MIN_SPIN_MARGIN_NSEC, MAX_SPIN_MARGIN_NSEC);
+}
+
+void FramePacer::_learn_overshoot(uint64_t p_overshoot_nsec) {
+	double overshoot = double(p_overshoot_nsec);
+	double deviation = Math::abs(overshoot - sleep_overshoot_nsec);
+	sleep_overshoot_nsec += (overshoot - sleep_overshoot_nsec) * OVERSHOOT_LEARN_RATE;
+	sleep_overshoot_deviation_nsec += (deviation - sleep_overshoot_deviation_nsec) * OVERSHOOT_LEARN_RATE;
+}
+
+void FramePacer::_os_sleep_until(uint64_t p_wake_nsec) const {
+#if defined(UNIX_ENABLED) && defined(CLOCK_MONOTONIC) && !defined(__APPLE__)
+	struct timespec ts;
+	ts.tv_sec = time_t(p_wake_nsec / 1000000000);
+	ts.tv_nsec = long(p_wake_nsec % 1000000000);
+	// Absolute deadline, so being interrupted by a signal doesn't make us drift.
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+	}
+#else
+	uint64_t now = get_ticks_nsec();
+	if (p_wake_nsec > now) {
+		OS::get_singleton()->delay_usec((p_wake_nsec - now) / 1000);
+	}
+#endif
+}
+
+void FramePacer::sleep_until(uint64_t p_deadline_nsec) {
+	uint64_t now = get_ticks_nsec();
+	while (now < p_deadline_nsec) {
+		uint64_t margin = _get_spin_margin_nsec();
+		if (p_deadline_nsec - now > margin) {
+			uint64_t wake_nsec = p_deadline_nsec - margin;
+			_os_sleep_until(wake_nsec);
+			uint64_t woke = get_ticks_nsec();
+			_learn_overshoot(woke > wake_nsec ? woke - wake_nsec : 0);
+			total_sleep_nsec += woke - now;
+			now = woke;
+			continue;
+		}
+
+		uint64_t spin_start = now;
+		while (now < p_deadline_nsec) {
+			_cpu_relax();
+			now = get_ticks_nsec();
+		}
+		total_spin_nsec += now - spin_start;
+	}
+}
+
+void FramePacer::set_target_fps(int p_fps) {
+	target_frame_nsec = p_fps > 0 ? 1000000000 / uint64_t(p_fps) : 0;
+	next_deadline_nsec = 0;
+}
+
+// With p_audio_sync, the frame starts as late as the next audio callback allows instead
+// of as soon as the frame delay and the frame rate cap do, but never earlier than them.
+void FramePacer::wait_for_next_frame(uint32_t p_frame_delay_msec, const AudioFrameSync *p_audio_sync) {
+	uint64_t now = get_ticks_nsec();
+
+	if (p_frame_delay_msec > 0) {
+		sleep_until(now + uint64_t(p_frame_delay_msec) * 1000000);
+		now = get_ticks_nsec();
+	}
+
+	uint64_t deadline = now;
+	if (target_frame_nsec > 0) {
+		if (next_deadline_nsec == 0) {
+			next_deadline_nsec = now;
+		}
+		next_deadline_nsec += target_frame_nsec;
+
+		if (now > next_deadline_nsec) {
+			deadlines_missed++;
+		} else {
+			deadline = next_deadline_nsec;
+		}
+	}
+	if (p_audio_sync && p_audio_sync->is_synced()) {
+		deadline = p_audio_sync->get_next_frame_start(deadline);
+	}
+	if (deadline > now) {
+		sleep_until(deadline);
+		now = get_ticks_nsec();
+	}
+
+	if (target_frame_nsec > 0) {
+		// Same policy as OS::add_frame_delay(): deadlines are absolute so we don't drift,
+		// but never let them fall more than a frame behind or run ahead of us.
+		next_deadline_nsec = CLAMP(next_deadline_nsec, now > target_frame_nsec ? now - target_frame_nsec : 0, now + target_frame_nsec);
+	}
+
+	if (last_frame_start_nsec > 0) {
+		uint64_t frame_nsec = now - last_frame_start_nsec;
+		if (frames_paced == 0) {
+			achieved_frame_nsec_avg = double(frame_nsec);
+		} else {
+			achieved_frame_nsec_avg += (double(frame_nsec) - achieved_frame_nsec_avg) * OVERSHOOT_LEARN_RATE;
+		}
+		achieved_frame_nsec_min = MIN(achieved_frame_nsec_min, frame_nsec);
+		achieved_frame_nsec_max = MAX(achieved_frame_nsec_max, frame_nsec);
+		frames_paced++;
+	}
+	last_frame_start_nsec = now;
+}
+
+Dictionary FramePacer::get_stats() const {
+	Dictionary stats;
+	stats["target_frame_time"] = target_frame_nsec / 1000000.0;
+	stats["achieved_frame_time_avg"] = achieved_frame_nsec_avg / 1000000.0;
+	stats["achieved_frame_time_min"] = frames_paced > 0 ? achieved_frame_nsec_min / 1000000.0 : 0.0;
+	stats["achieved_frame_time_max"] = achieved_frame_nsec_max / 1000000.0;
+	stats["frames"] = frames_paced;
+	stats["missed_deadlines"] = deadlines_missed;
+	stats["sleep_overshoot"] = sleep_overshoot_nsec / 1000000.0;
+	stats["spin_margin"] = _get_spin_margin_nsec() / 1000000.0;
+	stats["total_sleep_time"] = total_sleep_nsec / 1000000.0;
+	stats["total_spin_time"] = total_spin_nsec / 1000000.0;
+	return stats;
+}
+
+void FramePacer::reset_stats() {
+	frames_paced = 0;
+	deadlines_missed = 0;
+	achieved_frame_nsec_avg = 0.0;
+	achieved_frame_nsec_min = UINT64_MAX;
+	achieved_frame_nsec_max = 0;
+	total_sleep_nsec = 0;
+	total_spin_nsec = 0;
+	last_frame_start_nsec = 0;
+}
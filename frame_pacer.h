@@ -0,0 +1,49 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "core/config/audio_frame_sync.h"
+#include "core/typedefs.h"
+#include "core/variant/dictionary.h"
+
+// Limits the main loop to a target frame rate by combining an OS sleep with a short
+// busy-wait tail. The sleep is shortened by a margin learned online from how late the
+// OS actually wakes us up, so the spin tail stays small and we don't burn a core.
+class FramePacer {
+	static constexpr uint64_t MIN_SPIN_MARGIN_NSEC = 50000; // 0.05 ms.
+	static constexpr uint64_t MAX_SPIN_MARGIN_NSEC = 2000000; // 2 ms.
+	static constexpr double OVERSHOOT_LEARN_RATE = 1.0 / 16.0;
+
+	uint64_t target_frame_nsec = 0; // 0 means uncapped.
+	uint64_t next_deadline_nsec = 0;
+	uint64_t last_frame_start_nsec = 0;
+
+	double sleep_overshoot_nsec = 200000.0;
+	double sleep_overshoot_deviation_nsec = 100000.0;
+
+	uint64_t frames_paced = 0;
+	uint64_t deadlines_missed = 0;
+	double achieved_frame_nsec_avg = 0.0;
+	uint64_t achieved_frame_nsec_min = UINT64_MAX;
+	uint64_t achieved_frame_nsec_max = 0;
+	uint64_t total_sleep_nsec = 0;
+	uint64_t total_spin_nsec = 0;
+
+	uint64_t _get_spin_margin_nsec() const;
+	void _learn_overshoot(uint64_t p_overshoot_nsec);
+	void _os_sleep_until(uint64_t p_wake_nsec) const;
+
+public:
+	static uint64_t get_ticks_nsec();
+
+	void sleep_until(uint64_t p_deadline_nsec);
+
+	void set_target_fps(int p_fps);
+	uint64_t get_target_frame_nsec() const { return target_frame_nsec; }
+
+	void wait_for_next_frame(uint32_t p_frame_delay_msec = 0, const AudioFrameSync *p_audio_sync = nullptr);
+
+	Dictionary get_stats() const;
+	void reset_stats();
+};
+
+#endif // FRAME_PACER_H
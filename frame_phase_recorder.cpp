@@ -0,0 +1,166 @@
+#include "frame_phase_recorder.h"
+
+#include "core/config/frame_pacer.h"
+#include "core/io/file_access.h"
+#include "core/variant/dictionary.h"
+
+const char *FramePhaseRecorder::_get_phase_name(Phase p_phase) {
+	static const char *names[PHASE_MAX] = {
+		"Process",
+		"Physics",
+		"Server Sync",
+		"Draw",
+	};
+	return names[p_phase];
+}
+
+void FramePhaseRecorder::set_history_size(uint32_t p_frames) {
+	frames.resize(p_frames);
+	clear();
+}
+
+void FramePhaseRecorder::begin_frame(uint64_t p_frame) {
+	if (frames.is_empty()) {
+		return;
+	}
+
+	current = &frames[next_frame];
+	current->frame = p_frame;
+	current->begin_nsec = FramePacer::get_ticks_nsec();
+	current->end_nsec = current->begin_nsec;
+	current->event_count = 0;
+	current->dropped_events = 0;
+	open_event_count = 0;
+}
+
+void FramePhaseRecorder::end_frame() {
+	if (!current) {
+		return;
+	}
+
+	current->end_nsec = FramePacer::get_ticks_nsec();
+	// Close whatever phase was left open, so the frame is self-consistent.
+	while (open_event_count > 0) {
+		current->events[open_events[--open_event_count]].end_nsec = current->end_nsec;
+	}
+
+	current = nullptr;
+	next_frame = (next_frame + 1) % frames.size();
+	recorded_frames = MIN(recorded_frames + 1, frames.size());
+}
+
+void FramePhaseRecorder::begin_phase(Phase p_phase) {
+	if (!current) {
+		return;
+	}
+	if (current->event_count >= MAX_EVENTS_PER_FRAME || open_event_count >= MAX_NESTING) {
+		current->dropped_events++;
+		return;
+	}
+
+	Event &event = current->events[current->event_count];
+	event.phase = p_phase;
+	event.begin_nsec = FramePacer::get_ticks_nsec();
+	event.end_nsec = event.begin_nsec;
+	open_events[open_event_count++] = current->event_count++;
+}
+
+void FramePhaseRecorder::end_phase(Phase p_phase) {
+	if (!current || open_event_count == 0) {
+		return;
+	}
+
+	// Unwind to the innermost open phase that matches, closing the ones left open inside
+	// it. If none matches, its begin was dropped and there is nothing to close.
+	uint32_t depth = open_event_count;
+	while (depth > 0 && current->events[open_events[depth - 1]].phase != p_phase) {
+		depth--;
+	}
+	if (depth == 0) {
+		return;
+	}
+
+	uint64_t now = FramePacer::get_ticks_nsec();
+	while (open_event_count >= depth) {
+		current->events[open_events[--open_event_count]].end_nsec = now;
+	}
+}
+
+const FramePhaseRecorder::Frame &FramePhaseRecorder::get_recorded_frame(uint32_t p_index) const {
+	uint32_t count = get_recorded_frame_count();
+	CRASH_BAD_UNSIGNED_INDEX(p_index, count);
+	uint32_t oldest = (next_frame + frames.size() - count) % frames.size();
+	return frames[(oldest + p_index) % frames.size()];
+}
+
+Array FramePhaseRecorder::get_history() const {
+	Array history;
+	uint32_t count = get_recorded_frame_count();
+	for (uint32_t i = 0; i < count; i++) {
+		const Frame &frame = get_recorded_frame(i);
+
+		Dictionary frame_dict;
+		frame_dict["frame"] = frame.frame;
+		frame_dict["begin_usec"] = frame.begin_nsec / 1000;
+		frame_dict["duration_usec"] = (frame.end_nsec - frame.begin_nsec) / 1000;
+		frame_dict["dropped_phases"] = frame.dropped_events;
+
+		Array phases;
+		for (uint32_t j = 0; j < frame.event_count; j++) {
+			const Event &event = frame.events[j];
+			Dictionary phase_dict;
+			phase_dict["phase"] = _get_phase_name(event.phase);
+			phase_dict["begin_usec"] = event.begin_nsec / 1000;
+			phase_dict["duration_usec"] = (event.end_nsec - event.begin_nsec) / 1000;
+			phases.push_back(phase_dict);
+		}
+		frame_dict["phases"] = phases;
+
+		history.push_back(frame_dict);
+	}
+	return history;
+}
+
+// Writes the recorded frames in the Chrome trace event format, which can be opened
+// with chrome://tracing or Perfetto.
+Error FramePhaseRecorder::dump_chrome_trace(const String &p_path) const {
+	Error err;
+	Ref<FileAccess> f = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Can't open file for writing frame trace: " + p_path + ".");
+
+	uint32_t count = get_recorded_frame_count();
+	uint64_t origin_nsec = count > 0 ? get_recorded_frame(0).begin_nsec : 0;
+
+	f->store_string("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+	for (uint32_t i = 0; i < count; i++) {
+		const Frame &frame = get_recorded_frame(i);
+		String frame_args = "{\"frame\":" + itos(frame.frame) + "}";
+
+		String line = String(first ? "" : ",\n") + "{\"name\":\"Frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0" +
+				",\"ts\":" + String::num((frame.begin_nsec - origin_nsec) / 1000.0, 3) +
+				",\"dur\":" + String::num((frame.end_nsec - frame.begin_nsec) / 1000.0, 3) +
+				",\"args\":" + frame_args + "}";
+		f->store_string(line);
+		first = false;
+
+		for (uint32_t j = 0; j < frame.event_count; j++) {
+			const Event &event = frame.events[j];
+			line = String(",\n{\"name\":\"") + _get_phase_name(event.phase) + "\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":0,\"tid\":0" +
+					",\"ts\":" + String::num((event.begin_nsec - origin_nsec) / 1000.0, 3) +
+					",\"dur\":" + String::num((event.end_nsec - event.begin_nsec) / 1000.0, 3) +
+					",\"args\":" + frame_args + "}";
+			f->store_string(line);
+		}
+	}
+	f->store_string("\n]}\n");
+
+	return OK;
+}
+
+void FramePhaseRecorder::clear() {
+	next_frame = 0;
+	recorded_frames = 0;
+	current = nullptr;
+	open_event_count = 0;
+}
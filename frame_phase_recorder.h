@@ -0,0 +1,68 @@
+#ifndef FRAME_PHASE_RECORDER_H
+#define FRAME_PHASE_RECORDER_H
+
+#include "core/templates/local_vector.h"
+#include "core/variant/array.h"
+
+// Keeps begin/end timestamps of each main loop phase for the last N frames, so that
+// a slow frame can be broken down after the fact. Must only be used from the main thread.
+class FramePhaseRecorder {
+public:
+	enum Phase {
+		PHASE_PROCESS,
+		PHASE_PHYSICS,
+		PHASE_SERVER_SYNC,
+		PHASE_DRAW,
+		PHASE_MAX
+	};
+
+	static constexpr uint32_t MAX_EVENTS_PER_FRAME = 64;
+	static constexpr uint32_t MAX_NESTING = 4;
+
+	struct Event {
+		Phase phase = PHASE_PROCESS;
+		uint64_t begin_nsec = 0;
+		uint64_t end_nsec = 0;
+	};
+
+	struct Frame {
+		uint64_t frame = 0;
+		uint64_t begin_nsec = 0;
+		uint64_t end_nsec = 0;
+		uint32_t event_count = 0;
+		uint32_t dropped_events = 0;
+		Event events[MAX_EVENTS_PER_FRAME];
+	};
+
+private:
+	LocalVector<Frame> frames;
+	uint32_t next_frame = 0;
+	uint32_t recorded_frames = 0;
+	Frame *current = nullptr;
+
+	uint32_t open_events[MAX_NESTING];
+	uint32_t open_event_count = 0;
+
+	static const char *_get_phase_name(Phase p_phase);
+
+public:
+	void set_history_size(uint32_t p_frames);
+	uint32_t get_history_size() const { return frames.size(); }
+	bool is_enabled() const { return frames.size() > 0; }
+
+	void begin_frame(uint64_t p_frame);
+	void end_frame();
+	void begin_phase(Phase p_phase);
+	void end_phase(Phase p_phase);
+
+	// Mid-frame, the oldest slot is being overwritten by the current frame, so it's left out.
+	uint32_t get_recorded_frame_count() const { return current ? MIN(recorded_frames, frames.size() - 1) : recorded_frames; }
+	const Frame &get_recorded_frame(uint32_t p_index) const; // 0 is the oldest.
+
+	Array get_history() const;
+	Error dump_chrome_trace(const String &p_path) const;
+
+	void clear();
+};
+
+#endif // FRAME_PHASE_RECORDER_H
@@ -0,0 +1,123 @@
+#include "frame_time_histogram.h"
+
+#include "core/math/math_funcs.h"
+
+uint32_t FrameTimeHistogram::_get_bucket_index(uint64_t p_value) {
+	if (p_value < SUB_BUCKET_COUNT) {
+		return uint32_t(p_value);
+	}
+
+	uint32_t msb = 0;
+	for (uint64_t v = p_value; v > 1; v >>= 1) {
+		msb++;
+	}
+	uint32_t shift = msb - SUB_BUCKET_BITS;
+	return (shift + 1) * SUB_BUCKET_COUNT + uint32_t((p_value >> shift) - SUB_BUCKET_COUNT);
+}
+
+uint64_t FrameTimeHistogram::_get_bucket_value(uint32_t p_index) {
+	if (p_index < SUB_BUCKET_COUNT) {
+		return p_index;
+	}
+
+	// Middle of the range covered by the bucket.
+	uint32_t shift = p_index / SUB_BUCKET_COUNT - 1;
+	uint64_t low = uint64_t(p_index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT) << shift;
+	return low + ((uint64_t(1) << shift) >> 1);
+}
+
+void FrameTimeHistogram::_clear_slice(Slice &p_slice) {
+	p_slice.count.set(0);
+	for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+		p_slice.buckets[i].set(0);
+	}
+	p_slice.sum.set(0);
+	p_slice.max.set(0);
+}
+
+void FrameTimeHistogram::record(uint64_t p_usec) {
+	p_usec = MIN(p_usec, (uint64_t(1) << MAX_MAGNITUDE) - 1);
+
+	uint32_t current = current_slice.get();
+	if (slices[current].count.get() >= slice_samples) {
+		current = (current + 1) % WINDOW_SLICES;
+		_clear_slice(slices[current]);
+		current_slice.set(current);
+	}
+
+	Slice &slice = slices[current];
+	slice.buckets[_get_bucket_index(p_usec)].increment();
+	slice.sum.add(p_usec);
+	slice.max.exchange_if_greater(p_usec);
+	slice.count.increment();
+}
+
+void FrameTimeHistogram::set_window_size(uint32_t p_samples) {
+	ERR_FAIL_COND_MSG(p_samples < WINDOW_SLICES, vformat("Frame statistics window must hold at least %d samples.", WINDOW_SLICES));
+	slice_samples = p_samples / WINDOW_SLICES;
+	clear();
+}
+
+uint64_t FrameTimeHistogram::get_percentile(double p_percentile) const {
+	uint64_t total = get_count();
+	if (total == 0) {
+		return 0;
+	}
+
+	uint64_t rank = MAX(uint64_t(1), uint64_t(Math::ceil(CLAMP(p_percentile, 0.0, 100.0) / 100.0 * total)));
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+		for (uint32_t j = 0; j < WINDOW_SLICES; j++) {
+			seen += slices[j].buckets[i].get();
+		}
+		if (seen >= rank) {
+			// Never report more than was actually observed.
+			return MIN(_get_bucket_value(i), get_max());
+		}
+	}
+	return get_max();
+}
+
+uint64_t FrameTimeHistogram::get_max() const {
+	uint64_t max = 0;
+	for (uint32_t i = 0; i < WINDOW_SLICES; i++) {
+		max = MAX(max, slices[i].max.get());
+	}
+	return max;
+}
+
+double FrameTimeHistogram::get_mean() const {
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	for (uint32_t i = 0; i < WINDOW_SLICES; i++) {
+		count += slices[i].count.get();
+		sum += slices[i].sum.get();
+	}
+	return count > 0 ? double(sum) / count : 0.0;
+}
+
+uint64_t FrameTimeHistogram::get_count() const {
+	uint64_t count = 0;
+	for (uint32_t i = 0; i < WINDOW_SLICES; i++) {
+		count += slices[i].count.get();
+	}
+	return count;
+}
+
+Dictionary FrameTimeHistogram::get_stats() const {
+	Dictionary stats;
+	stats["p50"] = get_percentile(50) / 1000.0;
+	stats["p95"] = get_percentile(95) / 1000.0;
+	stats["p99"] = get_percentile(99) / 1000.0;
+	stats["max"] = get_max() / 1000.0;
+	stats["mean"] = get_mean() / 1000.0;
+	stats["samples"] = get_count();
+	return stats;
+}
+
+void FrameTimeHistogram::clear() {
+	for (uint32_t i = 0; i < WINDOW_SLICES; i++) {
+		_clear_slice(slices[i]);
+	}
+	current_slice.set(0);
+}
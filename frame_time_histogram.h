@@ -0,0 +1,51 @@
+#ifndef FRAME_TIME_HISTOGRAM_H
+#define FRAME_TIME_HISTOGRAM_H
+
+#include "core/templates/safe_refcount.h"
+#include "core/variant/dictionary.h"
+
+// Fixed-memory, log-linear (HDR-style) histogram of durations in microseconds over a
+// sliding window of frames. A single thread records; any thread may query without
+// locking. Each bucket has a relative error of at most 1 / SUB_BUCKET_COUNT.
+class FrameTimeHistogram {
+public:
+	static constexpr uint32_t SUB_BUCKET_BITS = 5;
+	static constexpr uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static constexpr uint32_t MAX_MAGNITUDE = 27; // Values are clamped below 2^27 usec (~134 seconds).
+	static constexpr uint32_t BUCKET_COUNT = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+	static constexpr uint32_t WINDOW_SLICES = 4;
+
+private:
+	// The window is split in slices so that old samples can be dropped in bulk:
+	// when the current slice is full, the oldest one is cleared and reused.
+	struct Slice {
+		SafeNumeric<uint32_t> buckets[BUCKET_COUNT];
+		SafeNumeric<uint32_t> count;
+		SafeNumeric<uint64_t> sum;
+		SafeNumeric<uint64_t> max;
+	};
+
+	Slice slices[WINDOW_SLICES];
+	SafeNumeric<uint32_t> current_slice;
+	uint32_t slice_samples = 256;
+
+	static uint32_t _get_bucket_index(uint64_t p_value);
+	static uint64_t _get_bucket_value(uint32_t p_index);
+	void _clear_slice(Slice &p_slice);
+
+public:
+	void record(uint64_t p_usec);
+
+	void set_window_size(uint32_t p_samples);
+	uint32_t get_window_size() const { return slice_samples * WINDOW_SLICES; }
+
+	uint64_t get_percentile(double p_percentile) const;
+	uint64_t get_max() const;
+	double get_mean() const;
+	uint64_t get_count() const;
+	Dictionary get_stats() const;
+
+	void clear();
+};
+
+#endif // FRAME_TIME_HISTOGRAM_H
@@ -0,0 +1,272 @@
+#include "global_class_registry.h"
+
+#include "core/io/file_access.h"
+#include "core/io/marshalls.h"
+
+GlobalClassRegistry::ClassInfo GlobalClassRegistry::ClassInfo::from_dictionary(const Dictionary &p_dict) {
+	ClassInfo info;
+	info.name = p_dict.get("class", StringName());
+	info.base = p_dict.get("base", StringName());
+	info.language = p_dict.get("language", StringName());
+	info.path = p_dict.get("path", String());
+	info.icon = p_dict.get("icon", String());
+	info.is_abstract = p_dict.get("is_abstract", false);
+	info.is_tool = p_dict.get("is_tool", false);
+	return info;
+}
+
+Dictionary GlobalClassRegistry::ClassInfo::to_dictionary() const {
+	Dictionary dict;
+	dict["class"] = name;
+	dict["base"] = base;
+	dict["language"] = language;
+	dict["path"] = path;
+	dict["icon"] = icon;
+	dict["is_abstract"] = is_abstract;
+	dict["is_tool"] = is_tool;
+	return dict;
+}
+
+void GlobalClassRegistry::_unindex(uint32_t p_index) {
+	const ClassInfo &info = classes[p_index];
+	by_name.erase(info.name);
+	by_path.erase(info.path);
+	HashSet<StringName> *inheriters = by_base.getptr(info.base);
+	if (inheriters) {
+		inheriters->erase(info.name);
+		if (inheriters->is_empty()) {
+			by_base.erase(info.base);
+		}
+	}
+}
+
+uint32_t GlobalClassRegistry::set_class(const ClassInfo &p_info) {
+	ERR_FAIL_COND_V_MSG(p_info.name == StringName(), classes.size(), "Global class must have a name.");
+
+	// A script that changed its class_name leaves its old name behind.
+	const uint32_t *path_index = by_path.getptr(p_info.path);
+	if (path_index && classes[*path_index].name != p_info.name) {
+		remove_class(classes[*path_index].name);
+	}
+
+	uint32_t index;
+	const uint32_t *name_index = by_name.getptr(p_info.name);
+	if (name_index) {
+		index = *name_index;
+		_unindex(index);
+		classes[index] = p_info;
+	} else {
+		index = classes.size();
+		classes.push_back(p_info);
+	}
+
+	by_name[p_info.name] = index;
+	if (!p_info.path.is_empty()) {
+		by_path[p_info.path] = index;
+	}
+	by_base[p_info.base].insert(p_info.name);
+	return index;
+}
+
+int GlobalClassRegistry::remove_class(const StringName &p_name) {
+	const uint32_t *name_index = by_name.getptr(p_name);
+	if (!name_index) {
+		return -1;
+	}
+
+	uint32_t index = *name_index;
+	_unindex(index);
+
+	uint32_t last = classes.size() - 1;
+	if (index != last) {
+		classes[index] = classes[last];
+		by_name[classes[index].name] = index;
+		if (!classes[index].path.is_empty()) {
+			by_path[classes[index].path] = index;
+		}
+	}
+	classes.resize(last);
+	return index;
+}
+
+const GlobalClassRegistry::ClassInfo *GlobalClassRegistry::get_class(const StringName &p_name) const {
+	const uint32_t *index = by_name.getptr(p_name);
+	return index ? &classes[*index] : nullptr;
+}
+
+const GlobalClassRegistry::ClassInfo *GlobalClassRegistry::get_class_by_path(const String &p_path) const {
+	const uint32_t *index = by_path.getptr(p_path);
+	return index ? &classes[*index] : nullptr;
+}
+
+const HashSet<StringName> *GlobalClassRegistry::get_inheriters(const StringName &p_base) const {
+	return by_base.getptr(p_base);
+}
+
+Error GlobalClassRegistry::save_binary(const String &p_path, uint32_t p_source_hash) const {
+	HashMap<String, uint32_t> string_indices;
+	LocalVector<CharString> strings;
+	auto add_string = [&](const String &p_string) -> uint32_t {
+		const uint32_t *index = string_indices.getptr(p_string);
+		if (index) {
+			return *index;
+		}
+		uint32_t new_index = strings.size();
+		string_indices[p_string] = new_index;
+		strings.push_back(p_string.utf8());
+		return new_index;
+	};
+
+	LocalVector<uint32_t> records;
+	records.reserve(classes.size() * (BINARY_RECORD_SIZE / sizeof(uint32_t)));
+	for (const ClassInfo &info : classes) {
+		records.push_back(add_string(info.name));
+		records.push_back(add_string(info.base));
+		records.push_back(add_string(info.language));
+		records.push_back(add_string(info.path));
+		records.push_back(add_string(info.icon));
+		records.push_back((info.is_abstract ? FLAG_ABSTRACT : 0) | (info.is_tool ? FLAG_TOOL : 0));
+	}
+
+	// String offsets, then the strings themselves, null-terminated.
+	uint32_t string_data_size = 0;
+	for (const CharString &string : strings) {
+		string_data_size += string.length() + 1;
+	}
+	uint32_t payload_size = records.size() * sizeof(uint32_t) + strings.size() * sizeof(uint32_t) + string_data_size;
+
+	Vector<uint8_t> buffer;
+	buffer.resize(BINARY_HEADER_SIZE + payload_size);
+	uint8_t *w = buffer.ptrw();
+	uint8_t *payload = w + BINARY_HEADER_SIZE;
+
+	uint8_t *p = payload;
+	for (uint32_t value : records) {
+		p += encode_uint32(value, p);
+	}
+	uint32_t string_offset = 0;
+	for (const CharString &string : strings) {
+		p += encode_uint32(string_offset, p);
+		string_offset += string.length() + 1;
+	}
+	for (const CharString &string : strings) {
+		memcpy(p, string.get_data(), string.length() + 1);
+		p += string.length() + 1;
+	}
+
+	p = w;
+	p += encode_uint32(BINARY_MAGIC, p);
+	p += encode_uint32(BINARY_VERSION, p);
+	p += encode_uint32(hash_murmur3_buffer(payload, payload_size), p);
+	p += encode_uint32(classes.size(), p);
+	p += encode_uint32(strings.size(), p);
+	p += encode_uint32(payload_size, p);
+	encode_uint32(p_source_hash, p);
+
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::WRITE);
+	ERR_FAIL_COND_V_MSG(file.is_null(), ERR_FILE_CANT_WRITE, "Couldn't save global class cache to '" + p_path + "'.");
+	file->store_buffer(buffer.ptr(), buffer.size());
+	return OK;
+}
+
+Error GlobalClassRegistry::load_binary(const String &p_path, uint32_t p_source_hash) {
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ);
+	if (file.is_null()) {
+		return ERR_FILE_NOT_FOUND;
+	}
+
+	uint64_t length = file->get_length();
+	if (length < BINARY_HEADER_SIZE) {
+		return ERR_FILE_CORRUPT;
+	}
+	Vector<uint8_t> buffer;
+	buffer.resize(length);
+	if (file->get_buffer(buffer.ptrw(), length) != length) {
+		return ERR_FILE_CORRUPT;
+	}
+
+	const uint8_t *r = buffer.ptr();
+	if (decode_uint32(r) != BINARY_MAGIC || decode_uint32(r + 4) != BINARY_VERSION) {
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	uint32_t hash = decode_uint32(r + 8);
+	uint32_t class_count = decode_uint32(r + 12);
+	uint32_t string_count = decode_uint32(r + 16);
+	uint32_t payload_size = decode_uint32(r + 20);
+	if (decode_uint32(r + 24) != p_source_hash) {
+		return ERR_FILE_CANT_OPEN; // Stale.
+	}
+
+	const uint8_t *payload = r + BINARY_HEADER_SIZE;
+	uint64_t tables_size = uint64_t(class_count) * BINARY_RECORD_SIZE + uint64_t(string_count) * sizeof(uint32_t);
+	if (payload_size != length - BINARY_HEADER_SIZE || tables_size > payload_size || hash_murmur3_buffer(payload, payload_size) != hash) {
+		return ERR_FILE_CORRUPT;
+	}
+
+	const uint8_t *offsets = payload + class_count * BINARY_RECORD_SIZE;
+	const char *string_data = reinterpret_cast<const char *>(offsets + string_count * sizeof(uint32_t));
+	uint32_t string_data_size = payload_size - tables_size;
+	if (string_data_size > 0 && string_data[string_data_size - 1] != 0) {
+		return ERR_FILE_CORRUPT;
+	}
+
+	LocalVector<String> strings;
+	strings.resize(string_count);
+	for (uint32_t i = 0; i < string_count; i++) {
+		uint32_t offset = decode_uint32(offsets + i * sizeof(uint32_t));
+		if (offset >= string_data_size) {
+			return ERR_FILE_CORRUPT;
+		}
+		strings[i] = String::utf8(string_data + offset);
+	}
+
+	clear();
+	classes.reserve(class_count);
+	const uint8_t *record = payload;
+	for (uint32_t i = 0; i < class_count; i++, record += BINARY_RECORD_SIZE) {
+		uint32_t fields[5];
+		for (uint32_t j = 0; j < 5; j++) {
+			fields[j] = decode_uint32(record + j * sizeof(uint32_t));
+			if (fields[j] >= string_count) {
+				clear();
+				return ERR_FILE_CORRUPT;
+			}
+		}
+		uint32_t flags = decode_uint32(record + 5 * sizeof(uint32_t));
+
+		ClassInfo info;
+		info.name = strings[fields[0]];
+		info.base = strings[fields[1]];
+		info.language = strings[fields[2]];
+		info.path = strings[fields[3]];
+		info.icon = strings[fields[4]];
+		info.is_abstract = flags & FLAG_ABSTRACT;
+		info.is_tool = flags & FLAG_TOOL;
+		set_class(info);
+	}
+	return OK;
+}
+
+void GlobalClassRegistry::set_from_array(const Array &p_classes) {
+	clear();
+	classes.reserve(p_classes.size());
+	for (int i = 0; i < p_classes.size(); i++) {
+		set_class(ClassInfo::from_dictionary(p_classes[i]));
+	}
+}
+
+Array GlobalClassRegistry::to_array() const {
+	Array array;
+	array.resize(classes.size());
+	for (uint32_t i = 0; i < classes.size(); i++) {
+		array[i] = classes[i].to_dictionary();
+	}
+	return array;
+}
+
+void GlobalClassRegistry::clear() {
+	classes.clear();
+	by_name.clear();
+	by_path.clear();
+	by_base.clear();
+}
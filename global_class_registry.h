@@ -0,0 +1,73 @@
+#ifndef GLOBAL_CLASS_REGISTRY_H
+#define GLOBAL_CLASS_REGISTRY_H
+
+#include "core/string/string_name.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/hash_set.h"
+#include "core/templates/local_vector.h"
+#include "core/variant/array.h"
+#include "core/variant/dictionary.h"
+
+// Global script classes (class_name) indexed by name, by script path and by base class.
+// Classes are kept densely in the order of the global class list they mirror: removing
+// one moves the last class into its place, so the list can be patched the same way.
+class GlobalClassRegistry {
+public:
+	struct ClassInfo {
+		StringName name;
+		StringName base;
+		StringName language;
+		String path;
+		String icon;
+		bool is_abstract = false;
+		bool is_tool = false;
+
+		static ClassInfo from_dictionary(const Dictionary &p_dict);
+		Dictionary to_dictionary() const;
+	};
+
+private:
+	LocalVector<ClassInfo> classes;
+	HashMap<StringName, uint32_t> by_name;
+	HashMap<String, uint32_t> by_path;
+	HashMap<StringName, HashSet<StringName>> by_base; // Direct inheriters.
+
+	// Binary cache: a header, fixed-size records and a string table, read with a single
+	// get_buffer() call. Strings are referenced by index, so names shared by many classes
+	// (bases, languages) are stored once.
+	static constexpr uint32_t BINARY_MAGIC = 0x43434447; // "GDCC"
+	static constexpr uint32_t BINARY_VERSION = 2;
+	static constexpr uint32_t BINARY_HEADER_SIZE = 7 * sizeof(uint32_t);
+	static constexpr uint32_t BINARY_RECORD_SIZE = 6 * sizeof(uint32_t);
+
+	enum {
+		FLAG_ABSTRACT = 1,
+		FLAG_TOOL = 2,
+	};
+
+	void _unindex(uint32_t p_index);
+
+public:
+	// Replaces the class with the same name in place, or appends it. Returns its index.
+	uint32_t set_class(const ClassInfo &p_info);
+	// Returns the index the class had, or -1 if there was none.
+	int remove_class(const StringName &p_name);
+
+	const ClassInfo *get_class(const StringName &p_name) const;
+	const ClassInfo *get_class_by_path(const String &p_path) const;
+	const HashSet<StringName> *get_inheriters(const StringName &p_base) const;
+
+	uint32_t size() const { return classes.size(); }
+	const ClassInfo &operator[](uint32_t p_index) const { return classes[p_index]; }
+
+	// p_source_hash is the content hash of the text cache the binary one was made from;
+	// loading fails if it doesn't match, so a stale binary cache is never used.
+	Error save_binary(const String &p_path, uint32_t p_source_hash) const;
+	Error load_binary(const String &p_path, uint32_t p_source_hash);
+
+	void set_from_array(const Array &p_classes);
+	Array to_array() const;
+	void clear();
+};
+
+#endif // GLOBAL_CLASS_REGISTRY_H
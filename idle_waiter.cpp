@@ -0,0 +1,35 @@
+#include "idle_waiter.h"
+
+#include "core/os/os.h"
+
+void IdleWaiter::post(uint32_t p_reasons) {
+#ifdef THREADS_ENABLED
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending |= p_reasons;
+	}
+	condition.notify_one();
+#else
+	pending |= p_reasons;
+#endif
+}
+
+// Returns the reasons posted since the last wait, or 0 on timeout.
+uint32_t IdleWaiter::wait(int64_t p_timeout_usec) {
+#ifdef THREADS_ENABLED
+	std::unique_lock<std::mutex> lock(mutex);
+	if (p_timeout_usec < 0) {
+		condition.wait(lock, [this] { return pending != 0; });
+	} else {
+		condition.wait_for(lock, std::chrono::microseconds(p_timeout_usec), [this] { return pending != 0; });
+	}
+#else
+	// Nobody else can post, just sleep until the deadline.
+	if (pending == 0 && p_timeout_usec > 0) {
+		OS::get_singleton()->delay_usec(p_timeout_usec);
+	}
+#endif
+	uint32_t reasons = pending;
+	pending = 0;
+	return reasons;
+}
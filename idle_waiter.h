@@ -0,0 +1,25 @@
+#ifndef IDLE_WAITER_H
+#define IDLE_WAITER_H
+
+#include "core/typedefs.h"
+
+#ifdef THREADS_ENABLED
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// Blocks the calling thread until another thread posts a wake-up or a timeout expires.
+// Wake-ups posted while nobody waits are not lost, the next wait returns immediately.
+class IdleWaiter {
+#ifdef THREADS_ENABLED
+	std::mutex mutex;
+	std::condition_variable condition;
+#endif
+	uint32_t pending = 0;
+
+public:
+	void post(uint32_t p_reasons);
+	uint32_t wait(int64_t p_timeout_usec); // Negative means no timeout.
+};
+
+#endif // IDLE_WAITER_H
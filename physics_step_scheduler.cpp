@@ -0,0 +1,117 @@
+#include "physics_step_scheduler.h"
+
+#include "core/error/error_macros.h"
+
+void PhysicsStepScheduler::set_mode(Mode p_mode) {
+	mode = p_mode;
+	if (mode == MODE_CLAMP) {
+		debt_steps = 0;
+	}
+	if (mode != MODE_ADAPTIVE) {
+		adaptive_ips = 0;
+		frames_in_debt = 0;
+		frames_without_debt = 0;
+	}
+}
+
+void PhysicsStepScheduler::set_max_debt_steps(int p_steps) {
+	ERR_FAIL_COND_MSG(p_steps < 0, "Maximum physics step debt can't be negative.");
+	max_debt_steps = p_steps;
+	debt_steps = MIN(debt_steps, max_debt_steps);
+}
+
+void PhysicsStepScheduler::set_catch_up_frames(int p_frames) {
+	ERR_FAIL_COND_MSG(p_frames <= 0, "Physics catch-up frames must be greater than 0.");
+	catch_up_frames = p_frames;
+}
+
+void PhysicsStepScheduler::set_min_adaptive_ips(int p_ips) {
+	ERR_FAIL_COND_MSG(p_ips <= 0, "Minimum adaptive physics ticks per second must be greater than 0.");
+	min_adaptive_ips = p_ips;
+}
+
+void PhysicsStepScheduler::_drop_steps(int p_steps, int p_ips) {
+	dropped_steps += p_steps;
+	dropped_time += double(p_steps) / p_ips;
+}
+
+void PhysicsStepScheduler::_update_adaptive_ips(int p_ips) {
+	if (debt_steps > max_debt_steps / 2) {
+		frames_without_debt = 0;
+		if (++frames_in_debt >= ADAPT_AFTER_FRAMES) {
+			// Still falling behind, lower the tick rate by 1/8th.
+			int current = get_effective_ips(p_ips);
+			adaptive_ips = MAX(min_adaptive_ips, current - MAX(1, current / 8));
+			frames_in_debt = 0;
+		}
+	} else if (debt_steps == 0) {
+		frames_in_debt = 0;
+		if (adaptive_ips > 0 && ++frames_without_debt >= RECOVER_AFTER_FRAMES) {
+			adaptive_ips += MAX(1, adaptive_ips / 8);
+			if (adaptive_ips >= p_ips) {
+				adaptive_ips = 0;
+			}
+			frames_without_debt = 0;
+		}
+	}
+}
+
+// Takes the number of steps due this frame (before any cap) and returns how many to run.
+int PhysicsStepScheduler::schedule(int p_due_steps, int p_max_steps_per_frame, int p_ips) {
+	scheduled_frames++;
+	int ips = get_effective_ips(p_ips);
+
+	if (mode == MODE_CLAMP) {
+		if (p_due_steps > p_max_steps_per_frame) {
+			capped_frames++;
+			_drop_steps(p_due_steps - p_max_steps_per_frame, ips);
+			return p_max_steps_per_frame;
+		}
+		return p_due_steps;
+	}
+
+	// Pay back a fraction of the debt each frame rather than all of it at once,
+	// so a single hitch doesn't turn into several heavy frames in a row.
+	int catch_up = (debt_steps + catch_up_frames - 1) / catch_up_frames;
+	int steps = p_due_steps + catch_up;
+	if (steps > p_max_steps_per_frame) {
+		capped_frames++;
+		steps = p_max_steps_per_frame;
+	}
+
+	debt_steps += p_due_steps - steps;
+	if (debt_steps > max_debt_steps) {
+		_drop_steps(debt_steps - max_debt_steps, ips);
+		debt_steps = max_debt_steps;
+	}
+
+	if (mode == MODE_ADAPTIVE) {
+		_update_adaptive_ips(p_ips);
+	}
+
+	return steps;
+}
+
+Dictionary PhysicsStepScheduler::get_stats(int p_ips) const {
+	Dictionary stats;
+	stats["mode"] = mode;
+	stats["debt_steps"] = debt_steps;
+	stats["debt_time"] = double(debt_steps) / get_effective_ips(p_ips);
+	stats["dropped_steps"] = dropped_steps;
+	stats["dropped_time"] = dropped_time;
+	stats["frames"] = scheduled_frames;
+	stats["capped_frames"] = capped_frames;
+	stats["effective_ticks_per_second"] = get_effective_ips(p_ips);
+	return stats;
+}
+
+void PhysicsStepScheduler::reset() {
+	debt_steps = 0;
+	adaptive_ips = 0;
+	frames_in_debt = 0;
+	frames_without_debt = 0;
+	scheduled_frames = 0;
+	capped_frames = 0;
+	dropped_steps = 0;
+	dropped_time = 0.0;
+}
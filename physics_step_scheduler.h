@@ -0,0 +1,64 @@
+#ifndef PHYSICS_STEP_SCHEDULER_H
+#define PHYSICS_STEP_SCHEDULER_H
+
+#include "core/typedefs.h"
+#include "core/variant/dictionary.h"
+
+// Decides how many physics steps run in a frame once the main loop timer has computed
+// how many are due. Steps that can't run within the per-frame cap are either dropped
+// (the historical behavior) or kept as debt and caught up over the following frames.
+// Debt is bounded so a server that can't keep up degrades instead of spiraling.
+class PhysicsStepScheduler {
+public:
+	enum Mode {
+		MODE_CLAMP,
+		MODE_SPREAD,
+		MODE_ADAPTIVE,
+	};
+
+private:
+	static constexpr int ADAPT_AFTER_FRAMES = 30;
+	static constexpr int RECOVER_AFTER_FRAMES = 120;
+
+	Mode mode = MODE_CLAMP;
+	int max_debt_steps = 16;
+	int catch_up_frames = 4;
+	int min_adaptive_ips = 10;
+
+	int debt_steps = 0;
+	int adaptive_ips = 0; // 0 when not reduced.
+	int frames_in_debt = 0;
+	int frames_without_debt = 0;
+
+	uint64_t scheduled_frames = 0;
+	uint64_t capped_frames = 0;
+	uint64_t dropped_steps = 0;
+	double dropped_time = 0.0;
+
+	void _drop_steps(int p_steps, int p_ips);
+	void _update_adaptive_ips(int p_ips);
+
+public:
+	void set_mode(Mode p_mode);
+	Mode get_mode() const { return mode; }
+
+	void set_max_debt_steps(int p_steps);
+	int get_max_debt_steps() const { return max_debt_steps; }
+
+	void set_catch_up_frames(int p_frames);
+	int get_catch_up_frames() const { return catch_up_frames; }
+
+	void set_min_adaptive_ips(int p_ips);
+	int get_min_adaptive_ips() const { return min_adaptive_ips; }
+
+	int schedule(int p_due_steps, int p_max_steps_per_frame, int p_ips);
+
+	int get_debt_steps() const { return debt_steps; }
+	double get_dropped_time() const { return dropped_time; }
+	int get_effective_ips(int p_ips) const { return adaptive_ips > 0 ? MIN(adaptive_ips, p_ips) : p_ips; }
+
+	Dictionary get_stats(int p_ips) const;
+	void reset();
+};
+
+#endif // PHYSICS_STEP_SCHEDULER_H
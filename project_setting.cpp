@@ -7,6 +7,7 @@
 #include "core/io/file_access.h"
 #include "core/io/file_access_pack.h"
 #include "core/io/marshalls.h"
+#include "core/io/resource_loader.h"
 #include "core/io/resource_uid.h"
 #include "core/object/script_language.h"
 #include "core/os/keyboard.h"
@@ -21,10 +22,106 @@
 
 const String ProjectSettings::PROJECT_DATA_DIR_NAME_SUFFIX = "godot";
 
+SettingsArena::Chunk *SettingsArena::chunks = nullptr;
+uint64_t SettingsArena::live_allocations = 0;
+thread_local bool SettingsArena::active = false;
+SafeFlag SettingsArena::has_chunks;
+SafeNumeric<uint64_t> SettingsArena::heap_allocations;
+SettingsArena::Stats SettingsArena::stats;
+
+static Mutex settings_arena_mutex;
+
+bool SettingsArena::_owns(const void *p_ptr) {
+	const uint8_t *ptr = static_cast<const uint8_t *>(p_ptr);
+	for (const Chunk *chunk = chunks; chunk; chunk = chunk->next) {
+		const uint8_t *begin = reinterpret_cast<const uint8_t *>(chunk + 1);
+		if (ptr >= begin && ptr < begin + chunk->size) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void SettingsArena::_release() {
+	while (chunks) {
+		Chunk *next = chunks->next;
+		Memory::free_static(chunks, false);
+		chunks = next;
+	}
+	stats.chunks = 0;
+	has_chunks.clear();
+}
+
+void *SettingsArena::alloc(size_t p_memory) {
+	if (!active) {
+		heap_allocations.increment();
+		return Memory::alloc_static(p_memory, false);
+	}
+
+	MutexLock lock(settings_arena_mutex);
+
+	size_t size = (p_memory + 15) & ~size_t(15);
+	if (!chunks || chunks->used + size > chunks->size) {
+		size_t chunk_size = MAX(CHUNK_SIZE, size);
+		// The header is 16-byte aligned in size too, so allocations stay aligned.
+		static_assert(sizeof(Chunk) % 16 == 0);
+		Chunk *chunk = static_cast<Chunk *>(Memory::alloc_static(sizeof(Chunk) + chunk_size, false));
+		chunk->next = chunks;
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		chunks = chunk;
+		stats.chunks++;
+		has_chunks.set();
+	}
+
+	void *ptr = reinterpret_cast<uint8_t *>(chunks + 1) + chunks->used;
+	chunks->used += size;
+	live_allocations++;
+	stats.arena_allocations++;
+	stats.arena_bytes += size;
+	return ptr;
+}
+
+void SettingsArena::free(void *p_ptr) {
+	if (!p_ptr) {
+		return;
+	}
+
+	// Arena nodes can only exist while there are chunks.
+	if (has_chunks.is_set()) {
+		MutexLock lock(settings_arena_mutex);
+		if (chunks && _owns(p_ptr)) {
+			if (--live_allocations == 0) {
+				_release();
+			}
+			return;
+		}
+	}
+
+	Memory::free_static(p_ptr, false);
+}
+
+SettingsArena::Stats SettingsArena::get_stats() {
+	MutexLock lock(settings_arena_mutex);
+	Stats ret = stats;
+	ret.heap_allocations = heap_allocations.get();
+	return ret;
+}
+
+SettingsArena::Scope::Scope() {
+	prev_active = active;
+	active = true;
+}
+
+SettingsArena::Scope::~Scope() {
+	active = prev_active;
+}
+
 ProjectSettings *ProjectSettings::singleton = nullptr;
+thread_local ProjectSettings *ProjectSettings::context_singleton = nullptr;
 
 ProjectSettings *ProjectSettings::get_singleton() {
-	return singleton;
+	return context_singleton ? context_singleton : singleton;
 }
 
 String ProjectSettings::get_project_data_dir_name() const {
@@ -183,11 +280,48 @@ String ProjectSettings::localize_path(const String &p_path) const {
 	}
 }
 
+// Arrays and dictionaries can be modified in place through the current value, so their
+// initial value always needs its own copy.
+static bool _is_shared_by_reference(const Variant &p_value) {
+	Variant::Type type = p_value.get_type();
+	return type == Variant::ARRAY || type == Variant::DICTIONARY || type == Variant::OBJECT;
+}
+
+Variant ProjectSettings::_get_initial_value(const StringName &p_name, const VariantContainer &p_container) const {
+	if (!p_container.has_initial) {
+		return Variant();
+	}
+	if (p_container.initial_stored) {
+		const Variant *initial = initial_values.getptr(p_name);
+		return initial ? *initial : Variant();
+	}
+	return p_container.variant;
+}
+
+// Changes the value of a setting, moving its initial value to the side table first if it
+// was shared with the current one.
+void ProjectSettings::_set_variant(const StringName &p_name, VariantContainer &p_container, const Variant &p_value) {
+	if (p_container.has_initial && !p_container.initial_stored && p_container.variant != p_value) {
+		initial_values[p_name] = p_container.variant;
+		p_container.initial_stored = true;
+	}
+	p_container.variant = p_value;
+}
+
 void ProjectSettings::set_initial_value(const String &p_name, const Variant &p_value) {
 	ERR_FAIL_COND_MSG(!props.has(p_name), "Request for nonexistent project setting: " + p_name + ".");
 
-	// Duplicate so that if value is array or dictionary, changing the setting will not change the stored initial value.
-	props[p_name].initial = p_value.duplicate();
+	VariantContainer &container = props[p_name];
+	container.has_initial = true;
+	if (!_is_shared_by_reference(p_value) && p_value == container.variant) {
+		container.initial_stored = false;
+		initial_values.erase(p_name);
+	} else {
+		// Duplicate so that if value is array or dictionary, changing the setting will not change the stored initial value.
+		container.initial_stored = true;
+		initial_values[p_name] = p_value.duplicate();
+	}
+	dirty_settings.insert(p_name);
 }
 
 void ProjectSettings::set_restart_if_changed(const String &p_name, bool p_restart) {
@@ -221,6 +355,19 @@ bool ProjectSettings::get_ignore_value_in_docs(const String &p_name) const {
 #endif
 }
 
+int ProjectSettings::get_order(const String &p_name) const {
+	ERR_FAIL_COND_V_MSG(!props.has(p_name), -1, "Request for nonexistent project setting: " + p_name + ".");
+	return props[p_name].order;
+}
+
+void ProjectSettings::set_order(const String &p_name, int p_order) {
+	ERR_FAIL_COND_MSG(!props.has(p_name), "Request for nonexistent project setting: " + p_name + ".");
+	props[p_name].order = p_order;
+	if (p_name.begins_with("autoload/")) {
+		_sort_autoload_table();
+	}
+}
+
 void ProjectSettings::add_hidden_prefix(const String &p_prefix) {
 	ERR_FAIL_COND_MSG(hidden_prefixes.has(p_prefix), vformat("Hidden prefix '%s' already exists.", p_prefix));
 	hidden_prefixes.push_back(p_prefix);
@@ -246,13 +393,23 @@ String ProjectSettings::globalize_path(const String &p_path) const {
 bool ProjectSettings::_set(const StringName &p_name, const Variant &p_value) {
 	_THREAD_SAFE_METHOD_
 
+	ERR_FAIL_COND_V_MSG(is_frozen(), false, "Can't change project setting '" + String(p_name) + "' while project settings are frozen.");
+
 	if (p_value.get_type() == Variant::NIL) {
 		props.erase(p_name);
+		initial_values.erase(p_name);
+		dirty_settings.insert(p_name);
 		if (p_name.operator String().begins_with("autoload/")) {
 			String node_name = p_name.operator String().split("/")[1];
 			if (autoloads.has(node_name)) {
 				remove_autoload(node_name);
 			}
+		} else if (p_name.operator String().begins_with("autoload_dependencies/")) {
+			String node_name = p_name.operator String().get_slice("/", 1);
+			autoload_dependencies.erase(node_name);
+			if (autoloads.has(node_name)) {
+				autoloads[node_name].dependencies.clear();
+			}
 		} else if (p_name.operator String().begins_with("global_group/")) {
 			String group_name = p_name.operator String().get_slice("/", 1);
 			if (global_groups.has(group_name)) {
@@ -265,6 +422,7 @@ bool ProjectSettings::_set(const StringName &p_name, const Variant &p_value) {
 			for (int i = 0; i < custom_feature_array.size(); i++) {
 				custom_features.insert(custom_feature_array[i]);
 			}
+			dirty_layout = true;
 			_queue_changed();
 			return true;
 		}
@@ -288,10 +446,11 @@ bool ProjectSettings::_set(const StringName &p_name, const Variant &p_value) {
 		}
 
 		if (props.has(p_name)) {
-			props[p_name].variant = p_value;
+			_set_variant(p_name, props[p_name], p_value);
 		} else {
 			props[p_name] = VariantContainer(p_value, last_order++);
 		}
+		dirty_settings.insert(p_name);
 		if (p_name.operator String().begins_with("autoload/")) {
 			String node_name = p_name.operator String().split("/")[1];
 			AutoloadInfo autoload;
@@ -303,7 +462,21 @@ bool ProjectSettings::_set(const StringName &p_name, const Variant &p_value) {
 			} else {
 				autoload.path = path.simplify_path();
 			}
+			if (autoload_dependencies.has(node_name)) {
+				autoload.dependencies = autoload_dependencies[node_name];
+			}
 			add_autoload(autoload);
+		} else if (p_name.operator String().begins_with("autoload_dependencies/")) {
+			String node_name = p_name.operator String().get_slice("/", 1);
+			PackedStringArray names = p_value;
+			Vector<StringName> dependencies;
+			for (const String &name : names) {
+				dependencies.push_back(name);
+			}
+			autoload_dependencies[node_name] = dependencies;
+			if (autoloads.has(node_name)) {
+				autoloads[node_name].dependencies = dependencies;
+			}
 		} else if (p_name.operator String().begins_with("global_group/")) {
 			String group_name = p_name.operator String().get_slice("/", 1);
 			add_global_group(group_name, p_value);
@@ -318,6 +491,9 @@ bool ProjectSettings::_get(const StringName &p_name, Variant &r_ret) const {
 	_THREAD_SAFE_METHOD_
 
 	if (!props.has(p_name)) {
+		if (parent_settings) {
+			return parent_settings->_get(p_name, r_ret);
+		}
 		WARN_PRINT("Property not found: " + String(p_name));
 		return false;
 	}
@@ -325,7 +501,83 @@ bool ProjectSettings::_get(const StringName &p_name, Variant &r_ret) const {
 	return true;
 }
 
+bool ProjectSettings::has_setting(const String &p_var) const {
+	_THREAD_SAFE_METHOD_
+
+	return props.has(p_var) || (parent_settings && parent_settings->has_setting(p_var));
+}
+
+// Settings of an EngineContext. It never becomes the process singleton and registers no
+// builtin settings: it only stores the settings it changes and reads everything else from
+// p_parent, so settings are loaded and stored once rather than per context.
+ProjectSettings::ProjectSettings(ProjectSettings *p_parent) {
+	parent_settings = p_parent;
+}
+
+ProjectSettings::~ProjectSettings() {
+	// The worker thread writes through this object, so it can't outlive it.
+	wait_for_async_save();
+
+	if (singleton == this) {
+		singleton = nullptr;
+	}
+}
+
+void ProjectSettings::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("has_setting", "name"), &ProjectSettings::has_setting);
+	ClassDB::bind_method(D_METHOD("set_setting", "name", "value"), &ProjectSettings::set_setting);
+	ClassDB::bind_method(D_METHOD("get_setting", "name", "default_value"), &ProjectSettings::get_setting, DEFVAL(Variant()));
+	ClassDB::bind_method(D_METHOD("get_setting_with_override", "name"), &ProjectSettings::get_setting_with_override);
+	ClassDB::bind_method(D_METHOD("get_global_class_list"), &ProjectSettings::get_global_class_list);
+	ClassDB::bind_method(D_METHOD("set_order", "name", "position"), &ProjectSettings::set_order);
+	ClassDB::bind_method(D_METHOD("get_order", "name"), &ProjectSettings::get_order);
+	ClassDB::bind_method(D_METHOD("set_initial_value", "name", "value"), &ProjectSettings::set_initial_value);
+	ClassDB::bind_method(D_METHOD("set_as_basic", "name", "basic"), &ProjectSettings::set_as_basic);
+	ClassDB::bind_method(D_METHOD("set_as_internal", "name", "internal"), &ProjectSettings::set_as_internal);
+	ClassDB::bind_method(D_METHOD("add_property_info", "hint"), &ProjectSettings::_add_property_info_bind);
+	ClassDB::bind_method(D_METHOD("set_restart_if_changed", "name", "restart"), &ProjectSettings::set_restart_if_changed);
+	ClassDB::bind_method(D_METHOD("clear", "name"), &ProjectSettings::clear);
+	ClassDB::bind_method(D_METHOD("localize_path", "path"), &ProjectSettings::localize_path);
+	ClassDB::bind_method(D_METHOD("globalize_path", "path"), &ProjectSettings::globalize_path);
+	ClassDB::bind_method(D_METHOD("save"), &ProjectSettings::save);
+	ClassDB::bind_method(D_METHOD("save_async"), &ProjectSettings::save_async);
+	ClassDB::bind_method(D_METHOD("wait_for_async_save"), &ProjectSettings::wait_for_async_save);
+	ClassDB::bind_method(D_METHOD("is_async_save_running"), &ProjectSettings::is_async_save_running);
+	ClassDB::bind_method(D_METHOD("load_resource_pack", "pack", "replace_files", "offset"), &ProjectSettings::_load_resource_pack, DEFVAL(true), DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("save_custom", "file"), &ProjectSettings::_save_custom_bnd);
+
+	ADD_SIGNAL(MethodInfo("settings_changed"));
+	ADD_SIGNAL(MethodInfo("settings_saved", PropertyInfo(Variant::INT, "error", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_DEFAULT | PROPERTY_USAGE_CLASS_IS_ENUM, "Error")));
+}
+
 Variant ProjectSettings::get_setting_with_override(const StringName &p_name) const {
+	if (is_frozen()) {
+		// The lookup takes no lock as the frozen table is immutable. The value is decoded
+		// into a new Variant, so reading writes nothing shared.
+		const FrozenSetting *frozen_setting = _find_frozen_setting(p_name);
+		if (frozen_setting) {
+			switch (frozen_setting->type) {
+				case Variant::NIL: {
+					return Variant();
+				}
+				case Variant::BOOL: {
+					return frozen_setting->value.b;
+				}
+				case Variant::INT: {
+					return frozen_setting->value.i;
+				}
+				case Variant::FLOAT: {
+					return frozen_setting->value.f;
+				}
+				default: {
+					Variant ret;
+					decode_variant(ret, frozen_arena.ptr() + frozen_setting->value.encoded.offset, frozen_setting->value.encoded.size, nullptr, false);
+					return ret;
+				}
+			}
+		}
+	}
+
 	_THREAD_SAFE_METHOD_
 
 	StringName name = p_name;
@@ -342,6 +594,9 @@ Variant ProjectSettings::get_setting_with_override(const StringName &p_name) con
 	}
 
 	if (!props.has(name)) {
+		if (parent_settings) {
+			return parent_settings->get_setting_with_override(p_name);
+		}
 		WARN_PRINT("Property not found: " + String(name));
 		return Variant();
 	}
@@ -464,19 +719,1677 @@ bool ProjectSettings::_load_resource_pack(const String &p_pack, bool p_replace_f
 	return true;
 }
 
-void ProjectSettings::_convert_to_last_version(int p_from_version) {
-	if (p_from_version <= 3) {
-		// Converts the actions from array to dictionary (array of events to dictionary with deadzone + events)
-		for (KeyValue<StringName, ProjectSettings::VariantContainer> &E : props) {
-			Variant value = E.value.variant;
-			if (String(E.key).begins_with("input/") && value.get_type() == Variant::ARRAY) {
-				Array array = value;
-				Dictionary action;
-				action["deadzone"] = Variant(0.5f);
-				action["events"] = array;
-				E.value.variant = action;
+// Content hash of a text cache, stored in the binary cache built from it so a stale
+// binary cache is never preferred over an edited text one.
+static uint32_t _hash_source_file(const String &p_path) {
+	if (!FileAccess::exists(p_path)) {
+		return 0;
+	}
+	Vector<uint8_t> data = FileAccess::get_file_as_bytes(p_path);
+	return hash_murmur3_buffer(data.ptr(), data.size());
+}
+
+TypedArray<Dictionary> ProjectSettings::get_global_class_list() {
+	_THREAD_SAFE_METHOD_
+
+	if (is_global_class_list_loaded) {
+		return global_class_list;
+	}
+
+	// The binary cache skips parsing the text one, as long as it was made from it.
+	if (load_global_class_list_binary()) {
+		return global_class_list;
+	}
+
+	Ref<ConfigFile> cf;
+	cf.instantiate();
+	if (cf->load(get_global_class_list_path()) == OK) {
+		global_class_list = cf->get_value("", "list", Array());
+	} else {
+#ifndef TOOLS_ENABLED
+		// Script classes can't be recreated in exported project, so print an error.
+		ERR_PRINT("Could not load global script cache.");
+#endif
+	}
+
+	// File read succeeded or failed. If it failed, assume everything is still okay.
+	// We will later receive updated class data in store_global_class_list().
+	is_global_class_list_loaded = true;
+	return global_class_list;
+}
+
+void ProjectSettings::store_global_class_list(const Array &p_classes) {
+	_THREAD_SAFE_METHOD_
+
+	Ref<ConfigFile> cf;
+	cf.instantiate();
+	cf->set_value("", "list", p_classes);
+	cf->save(get_global_class_list_path());
+
+	// The index is rebuilt from the new array on the next lookup.
+	global_class_list = p_classes;
+	global_class_registry_source = nullptr;
+	is_global_class_list_loaded = true;
+
+	store_global_class_list_binary();
+}
+
+void ProjectSettings::_update_global_class_registry() {
+	if (global_class_registry_source == global_class_list.id() && global_class_registry.size() == uint32_t(global_class_list.size())) {
+		return;
+	}
+
+	global_class_registry.set_from_array(global_class_list);
+	if (global_class_registry.size() != uint32_t(global_class_list.size())) {
+		// Duplicated names or paths were dropped, keep the list in the registry order.
+		global_class_list = global_class_registry.to_array();
+	}
+	global_class_registry_source = global_class_list.id();
+}
+
+String ProjectSettings::get_global_class_list_binary_path() const {
+	return get_global_class_list_path().get_basename() + ".bin";
+}
+
+// Writes the binary cache next to the text one, which must have been stored first.
+Error ProjectSettings::store_global_class_list_binary() {
+	_THREAD_SAFE_METHOD_
+
+	_update_global_class_registry();
+	return global_class_registry.save_binary(get_global_class_list_binary_path(), _hash_source_file(get_global_class_list_path()));
+}
+
+// Loads the global class list from the binary cache. Returns false if it is missing,
+// corrupt or not made from the current text cache, in which case the text cache should be read.
+bool ProjectSettings::load_global_class_list_binary() {
+	_THREAD_SAFE_METHOD_
+
+	Error err = global_class_registry.load_binary(get_global_class_list_binary_path(), _hash_source_file(get_global_class_list_path()));
+	if (err != OK) {
+		if (err != ERR_FILE_NOT_FOUND) {
+			print_verbose(vformat("ProjectSettings: Ignoring binary global class cache (%s).", error_names[err]));
+		}
+		global_class_registry.clear();
+		global_class_registry_source = nullptr;
+		return false;
+	}
+
+	global_class_list = global_class_registry.to_array();
+	global_class_registry_source = global_class_list.id();
+	is_global_class_list_loaded = true;
+	return true;
+}
+
+// Adds or updates a single class without refreshing the whole list.
+void ProjectSettings::add_global_class(const Dictionary &p_class) {
+	_THREAD_SAFE_METHOD_
+
+	_update_global_class_registry();
+	GlobalClassRegistry::ClassInfo info = GlobalClassRegistry::ClassInfo::from_dictionary(p_class);
+	const GlobalClassRegistry::ClassInfo *previous = global_class_registry.get_class_by_path(info.path);
+	if (previous && previous->name != info.name) {
+		remove_global_class(previous->name);
+	}
+
+	uint32_t index = global_class_registry.set_class(info);
+	if (index == uint32_t(global_class_list.size())) {
+		global_class_list.push_back(p_class);
+	} else {
+		global_class_list[index] = p_class;
+	}
+}
+
+void ProjectSettings::remove_global_class(const StringName &p_class) {
+	_THREAD_SAFE_METHOD_
+
+	_update_global_class_registry();
+	int index = global_class_registry.remove_class(p_class);
+	if (index < 0) {
+		return;
+	}
+
+	int last = global_class_list.size() - 1;
+	if (index != last) {
+		global_class_list[index] = global_class_list[last];
+	}
+	global_class_list.resize(last);
+}
+
+bool ProjectSettings::get_global_class_info(const StringName &p_class, GlobalClassRegistry::ClassInfo &r_info) {
+	_THREAD_SAFE_METHOD_
+
+	_update_global_class_registry();
+	const GlobalClassRegistry::ClassInfo *info = global_class_registry.get_class(p_class);
+	if (!info) {
+		return false;
+	}
+	r_info = *info;
+	return true;
+}
+
+StringName ProjectSettings::get_global_class_name_for_path(const String &p_path) {
+	_THREAD_SAFE_METHOD_
+
+	_update_global_class_registry();
+	const GlobalClassRegistry::ClassInfo *info = global_class_registry.get_class_by_path(p_path);
+	return info ? info->name : StringName();
+}
+
+Vector<StringName> ProjectSettings::get_global_class_inheriters(const StringName &p_base) {
+	_THREAD_SAFE_METHOD_
+
+	_update_global_class_registry();
+	Vector<StringName> inheriters;
+	const HashSet<StringName> *set = global_class_registry.get_inheriters(p_base);
+	if (set) {
+		for (const StringName &E : *set) {
+			inheriters.push_back(E);
+		}
+	}
+	return inheriters;
+}
+
+void ProjectSettings::add_scene_groups_cache(const StringName &p_path, const HashSet<StringName> &p_cache) {
+	_THREAD_SAFE_METHOD_
+
+	_update_scene_groups_index(p_path, scene_groups_cache.getptr(p_path), &p_cache);
+	scene_groups_cache[p_path] = p_cache;
+}
+
+void ProjectSettings::remove_scene_groups_cache(const StringName &p_path) {
+	_THREAD_SAFE_METHOD_
+
+	_update_scene_groups_index(p_path, scene_groups_cache.getptr(p_path), nullptr);
+	scene_groups_cache.erase(p_path);
+}
+
+void ProjectSettings::save_scene_groups_cache() {
+	_THREAD_SAFE_METHOD_
+
+	Ref<ConfigFile> cf;
+	cf.instantiate();
+	for (const KeyValue<StringName, HashSet<StringName>> &E : scene_groups_cache) {
+		if (E.value.is_empty()) {
+			continue;
+		}
+		Array list;
+		for (const StringName &group : E.value) {
+			list.push_back(group);
+		}
+		cf->set_value(E.key, "groups", list);
+	}
+	cf->save(get_scene_groups_cache_path());
+
+	save_scene_groups_cache_binary();
+}
+
+void ProjectSettings::load_scene_groups_cache() {
+	_THREAD_SAFE_METHOD_
+
+	// The binary cache skips parsing the text one, as long as it was made from it.
+	if (load_scene_groups_cache_binary()) {
+		return;
+	}
+
+	Ref<ConfigFile> cf;
+	cf.instantiate();
+	if (cf->load(get_scene_groups_cache_path()) == OK) {
+		List<String> scene_paths;
+		cf->get_sections(&scene_paths);
+		for (const String &E : scene_paths) {
+			Array scene_groups = cf->get_value(E, "groups", Array());
+			HashSet<StringName> cache;
+			for (const Variant &scene_group : scene_groups) {
+				cache.insert(scene_group);
+			}
+			add_scene_groups_cache(E, cache);
+		}
+	}
+}
+
+void ProjectSettings::_rebuild_scene_groups_index() const {
+	scene_groups_index.clear();
+	for (const KeyValue<StringName, HashSet<StringName>> &E : scene_groups_cache) {
+		for (const StringName &group : E.value) {
+			scene_groups_index[group].insert(E.key);
+		}
+	}
+	scene_groups_index_valid = true;
+}
+
+// Keeps scene_groups_index in sync with a change of the groups of one scene. Called by
+// add_scene_groups_cache() and remove_scene_groups_cache() before they touch the cache.
+// Until the index is first built it is left alone, get_scenes_in_group() builds it whole.
+void ProjectSettings::_update_scene_groups_index(const StringName &p_path, const HashSet<StringName> *p_old_groups, const HashSet<StringName> *p_new_groups) {
+	_THREAD_SAFE_METHOD_
+
+	if (!scene_groups_index_valid) {
+		return;
+	}
+	if (p_old_groups) {
+		for (const StringName &group : *p_old_groups) {
+			if (p_new_groups && p_new_groups->has(group)) {
+				continue;
 			}
-Error ProjectSettings::_setup(const String &p_path, const String &p_main_pack, bool p_upwards, bool p_ignore_override) {
+			HashSet<StringName> *scenes = scene_groups_index.getptr(group);
+			if (scenes) {
+				scenes->erase(p_path);
+				if (scenes->is_empty()) {
+					scene_groups_index.erase(group);
+				}
+			}
+		}
+	}
+	if (p_new_groups) {
+		for (const StringName &group : *p_new_groups) {
+			scene_groups_index[group].insert(p_path);
+		}
+	}
+}
+
+Vector<StringName> ProjectSettings::get_scenes_in_group(const StringName &p_group) const {
+	_THREAD_SAFE_METHOD_
+
+	if (!scene_groups_index_valid) {
+		_rebuild_scene_groups_index();
+	}
+	Vector<StringName> scenes;
+	const HashSet<StringName> *set = scene_groups_index.getptr(p_group);
+	if (set) {
+		for (const StringName &E : *set) {
+			scenes.push_back(E);
+		}
+	}
+	return scenes;
+}
+
+String ProjectSettings::get_scene_groups_cache_binary_path() const {
+	return get_scene_groups_cache_path().get_basename() + ".bin";
+}
+
+// Binary scene groups cache: a header, a string table shared by scene paths and group
+// names, then per scene its path and group indices. Loaded with a single read.
+static constexpr uint32_t SCENE_GROUPS_CACHE_MAGIC = 0x47534447; // "GDSG"
+static constexpr uint32_t SCENE_GROUPS_CACHE_VERSION = 2;
+static constexpr uint32_t SCENE_GROUPS_CACHE_HEADER_SIZE = 7 * sizeof(uint32_t);
+
+Error ProjectSettings::save_scene_groups_cache_binary() {
+	_THREAD_SAFE_METHOD_
+
+	HashMap<StringName, uint32_t> string_indices;
+	LocalVector<CharString> strings;
+	LocalVector<uint32_t> scenes; // Path, group count, groups...
+	uint32_t scene_count = 0;
+
+	auto add_string = [&](const StringName &p_string) -> uint32_t {
+		const uint32_t *index = string_indices.getptr(p_string);
+		if (index) {
+			return *index;
+		}
+		uint32_t new_index = strings.size();
+		string_indices[p_string] = new_index;
+		strings.push_back(String(p_string).utf8());
+		return new_index;
+	};
+
+	for (const KeyValue<StringName, HashSet<StringName>> &E : scene_groups_cache) {
+		if (E.value.is_empty()) {
+			continue;
+		}
+		scenes.push_back(add_string(E.key));
+		scenes.push_back(E.value.size());
+		for (const StringName &group : E.value) {
+			scenes.push_back(add_string(group));
+		}
+		scene_count++;
+	}
+
+	uint32_t string_data_size = 0;
+	for (const CharString &string : strings) {
+		string_data_size += string.length() + 1;
+	}
+	uint32_t payload_size = (strings.size() + scenes.size()) * sizeof(uint32_t) + string_data_size;
+
+	Vector<uint8_t> buffer;
+	buffer.resize(SCENE_GROUPS_CACHE_HEADER_SIZE + payload_size);
+	uint8_t *w = buffer.ptrw();
+	uint8_t *payload = w + SCENE_GROUPS_CACHE_HEADER_SIZE;
+
+	uint8_t *p = payload;
+	for (uint32_t value : scenes) {
+		p += encode_uint32(value, p);
+	}
+	uint32_t string_offset = 0;
+	for (const CharString &string : strings) {
+		p += encode_uint32(string_offset, p);
+		string_offset += string.length() + 1;
+	}
+	for (const CharString &string : strings) {
+		memcpy(p, string.get_data(), string.length() + 1);
+		p += string.length() + 1;
+	}
+
+	p = w;
+	p += encode_uint32(SCENE_GROUPS_CACHE_MAGIC, p);
+	p += encode_uint32(SCENE_GROUPS_CACHE_VERSION, p);
+	p += encode_uint32(hash_murmur3_buffer(payload, payload_size), p);
+	p += encode_uint32(scene_count, p);
+	p += encode_uint32(strings.size(), p);
+	p += encode_uint32(scenes.size(), p);
+	encode_uint32(_hash_source_file(get_scene_groups_cache_path()), p);
+
+	String path = get_scene_groups_cache_binary_path();
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+	ERR_FAIL_COND_V_MSG(file.is_null(), ERR_FILE_CANT_WRITE, "Couldn't save scene groups cache to '" + path + "'.");
+	file->store_buffer(buffer.ptr(), buffer.size());
+	return OK;
+}
+
+// Replaces the scene groups cache with the binary one. Returns false if it is missing,
+// corrupt or not made from the current text cache, in which case the text cache should be loaded instead.
+bool ProjectSettings::load_scene_groups_cache_binary() {
+	_THREAD_SAFE_METHOD_
+
+	Ref<FileAccess> file = FileAccess::open(get_scene_groups_cache_binary_path(), FileAccess::READ);
+	if (file.is_null()) {
+		return false;
+	}
+
+	uint64_t length = file->get_length();
+	if (length < SCENE_GROUPS_CACHE_HEADER_SIZE) {
+		return false;
+	}
+	Vector<uint8_t> buffer;
+	buffer.resize(length);
+	if (file->get_buffer(buffer.ptrw(), length) != length) {
+		return false;
+	}
+
+	const uint8_t *r = buffer.ptr();
+	if (decode_uint32(r) != SCENE_GROUPS_CACHE_MAGIC || decode_uint32(r + 4) != SCENE_GROUPS_CACHE_VERSION) {
+		return false;
+	}
+	uint32_t hash = decode_uint32(r + 8);
+	uint32_t scene_count = decode_uint32(r + 12);
+	uint32_t string_count = decode_uint32(r + 16);
+	uint32_t scene_words = decode_uint32(r + 20);
+	if (decode_uint32(r + 24) != _hash_source_file(get_scene_groups_cache_path())) {
+		return false;
+	}
+
+	const uint8_t *payload = r + SCENE_GROUPS_CACHE_HEADER_SIZE;
+	uint64_t payload_size = length - SCENE_GROUPS_CACHE_HEADER_SIZE;
+	uint64_t tables_size = (uint64_t(scene_words) + string_count) * sizeof(uint32_t);
+	ERR_FAIL_COND_V_MSG(tables_size > payload_size || hash_murmur3_buffer(payload, payload_size) != hash, false, "Scene groups cache is corrupt, ignoring it.");
+
+	const uint8_t *offsets = payload + scene_words * sizeof(uint32_t);
+	const char *string_data = reinterpret_cast<const char *>(offsets + string_count * sizeof(uint32_t));
+	uint64_t string_data_size = payload_size - tables_size;
+	ERR_FAIL_COND_V(string_data_size > 0 && string_data[string_data_size - 1] != 0, false);
+
+	LocalVector<StringName> strings;
+	strings.resize(string_count);
+	for (uint32_t i = 0; i < string_count; i++) {
+		uint32_t offset = decode_uint32(offsets + i * sizeof(uint32_t));
+		ERR_FAIL_COND_V(offset >= string_data_size, false);
+		strings[i] = StringName(String::utf8(string_data + offset));
+	}
+
+	HashMap<StringName, HashSet<StringName>> cache;
+	HashMap<StringName, HashSet<StringName>> index;
+	cache.reserve(scene_count);
+	uint32_t word = 0;
+	auto read_word = [&](uint32_t &r_value) -> bool {
+		if (word >= scene_words) {
+			return false;
+		}
+		r_value = decode_uint32(payload + word++ * sizeof(uint32_t));
+		return true;
+	};
+
+	for (uint32_t i = 0; i < scene_count; i++) {
+		uint32_t path = 0;
+		uint32_t group_count = 0;
+		ERR_FAIL_COND_V(!read_word(path) || !read_word(group_count) || path >= string_count, false);
+
+		HashSet<StringName> &groups = cache[strings[path]];
+		for (uint32_t j = 0; j < group_count; j++) {
+			uint32_t group = 0;
+			ERR_FAIL_COND_V(!read_word(group) || group >= string_count, false);
+			groups.insert(strings[group]);
+			index[strings[group]].insert(strings[path]);
+		}
+	}
+
+	scene_groups_cache = cache;
+	scene_groups_index = index;
+	scene_groups_index_valid = true;
+	return true;
+}
+
+void ProjectSettings::_reindex_autoload_table(uint32_t p_from) {
+	for (uint32_t i = p_from; i < autoload_table.size(); i++) {
+		autoload_table_indices[autoload_table[i].name] = i;
+	}
+}
+
+void ProjectSettings::_add_to_autoload_table(const StringName &p_name, int p_order) {
+	const uint32_t *index = autoload_table_indices.getptr(p_name);
+	if (index) {
+		if (autoload_table[*index].order == p_order) {
+			return;
+		}
+		_remove_from_autoload_table(p_name);
+	}
+
+	// New autoloads almost always come last, so search from the end.
+	uint32_t position = autoload_table.size();
+	while (position > 0 && autoload_table[position - 1].order > p_order) {
+		position--;
+	}
+
+	OrderedAutoload autoload;
+	autoload.name = p_name;
+	autoload.order = p_order;
+	autoload_table.insert(position, autoload);
+	_reindex_autoload_table(position);
+}
+
+void ProjectSettings::_remove_from_autoload_table(const StringName &p_name) {
+	const uint32_t *index = autoload_table_indices.getptr(p_name);
+	if (!index) {
+		return;
+	}
+	uint32_t position = *index;
+	autoload_table_indices.erase(p_name);
+	autoload_table.remove_at(position);
+	_reindex_autoload_table(position);
+}
+
+// Needed after the order of an autoload setting changed (set_order()).
+void ProjectSettings::_sort_autoload_table() {
+	for (OrderedAutoload &autoload : autoload_table) {
+		const VariantContainer *container = props.getptr("autoload/" + String(autoload.name));
+		if (container) {
+			autoload.order = container->order;
+		}
+	}
+
+	struct OrderComparator {
+		bool operator()(const OrderedAutoload &p_a, const OrderedAutoload &p_b) const { return p_a.order < p_b.order; }
+	};
+	autoload_table.sort_custom<OrderComparator>();
+	_reindex_autoload_table(0);
+}
+
+void ProjectSettings::add_autoload(const AutoloadInfo &p_autoload) {
+	ERR_FAIL_COND_MSG(p_autoload.name == StringName(), "Trying to add autoload with no name.");
+	autoloads[p_autoload.name] = p_autoload;
+
+	// Autoloads added without a setting go last.
+	const VariantContainer *container = props.getptr("autoload/" + String(p_autoload.name));
+	_add_to_autoload_table(p_autoload.name, container ? container->order : last_order);
+}
+
+void ProjectSettings::remove_autoload(const StringName &p_autoload) {
+	ERR_FAIL_COND_MSG(!autoloads.has(p_autoload), "Trying to remove non-existent autoload.");
+	autoloads.erase(p_autoload);
+	_remove_from_autoload_table(p_autoload);
+}
+
+int ProjectSettings::get_autoload_index(const StringName &p_name) const {
+	const uint32_t *index = autoload_table_indices.getptr(p_name);
+	return index ? int(*index) : -1;
+}
+
+// Groups the autoloads in waves, each depending only on the ones before it, so the
+// resources of a wave can be loaded in parallel. Autoloads keep their order within a wave.
+Vector<Vector<StringName>> ProjectSettings::get_autoload_load_waves() const {
+	_THREAD_SAFE_METHOD_
+
+	HashMap<StringName, int> waves_of;
+	int wave_count = 0;
+
+	// Dependencies may come later in the order, so go over the list until nothing changes.
+	bool progress = true;
+	while (waves_of.size() < autoload_table.size() && progress) {
+		progress = false;
+		for (const OrderedAutoload &autoload : autoload_table) {
+			const StringName &name = autoload.name;
+			if (waves_of.has(name)) {
+				continue;
+			}
+
+			const AutoloadInfo *info = autoloads.getptr(name);
+			int wave = 0;
+			bool ready = true;
+			for (const StringName &dependency : info ? info->dependencies : Vector<StringName>()) {
+				if (!autoload_table_indices.has(dependency)) {
+					continue;
+				}
+				const int *dependency_wave = waves_of.getptr(dependency);
+				if (!dependency_wave) {
+					ready = false;
+					break;
+				}
+				wave = MAX(wave, *dependency_wave + 1);
+			}
+
+			if (ready) {
+				waves_of[name] = wave;
+				wave_count = MAX(wave_count, wave + 1);
+				progress = true;
+			}
+		}
+	}
+
+	// Whatever is left is part of a cycle, load it one by one at the end.
+	for (const OrderedAutoload &autoload : autoload_table) {
+		if (!waves_of.has(autoload.name)) {
+			ERR_PRINT(vformat("Autoload '%s' has circular dependencies, loading it after the others.", autoload.name));
+			waves_of[autoload.name] = wave_count++;
+		}
+	}
+
+	Vector<Vector<StringName>> waves;
+	waves.resize(wave_count);
+	for (const OrderedAutoload &autoload : autoload_table) {
+		waves.write[waves_of[autoload.name]].push_back(autoload.name);
+	}
+	return waves;
+}
+
+// Loads the resources of all autoloads ahead of adding them to the tree, a wave at a
+// time on worker threads. Autoloads are then instantiated in their usual order, finding
+// their resources loaded already.
+void ProjectSettings::preload_autoloads(HashMap<StringName, Ref<Resource>> &r_resources) {
+	uint64_t usec = OS::get_singleton()->get_ticks_usec();
+	Vector<Vector<StringName>> waves = get_autoload_load_waves();
+
+	for (const Vector<StringName> &wave : waves) {
+		LocalVector<Pair<StringName, String>> requested;
+		for (const StringName &name : wave) {
+			String path = get_autoload(name).path;
+			if (ResourceLoader::load_threaded_request(path) == OK) {
+				requested.push_back(Pair<StringName, String>(name, path));
+			} else {
+				ERR_PRINT(vformat("Failed to start loading autoload '%s' from '%s'.", name, path));
+			}
+		}
+
+		for (const Pair<StringName, String> &E : requested) {
+			Error err = OK;
+			Ref<Resource> res = ResourceLoader::load_threaded_get(E.second, &err);
+			if (res.is_valid()) {
+				r_resources[E.first] = res;
+			} else {
+				ERR_PRINT(vformat("Failed to load autoload '%s' from '%s' (%s).", E.first, E.second, error_names[err]));
+			}
+		}
+	}
+
+	print_verbose(vformat("ProjectSettings: Preloaded %d autoloads in %d waves in %d usec.", r_resources.size(), waves.size(), OS::get_singleton()->get_ticks_usec() - usec));
+}
+
+String ProjectSettings::get_compiled_input_map_path() const {
+	return get_project_data_path().path_join("input_map.bin");
+}
+
+void ProjectSettings::_add_settings_file_hash(uint32_t p_hash) {
+	settings_files_hash = settings_files_hash == 0 ? p_hash : hash_murmur3_one_32(p_hash, settings_files_hash);
+}
+
+// Compiles the "input/" settings (with feature overrides applied) into a flat input map.
+// Meant to be run at export time, so the exported project can load it directly. The map
+// is only loaded along with the same settings file: p_settings_path is the settings file
+// it goes with (e.g. the exported project.binary), by default the ones loaded now.
+Error ProjectSettings::save_compiled_input_map(const String &p_path, const String &p_settings_path) {
+	_THREAD_SAFE_METHOD_
+
+	CompiledInputMap map;
+	for (const KeyValue<StringName, VariantContainer> &E : props) {
+		String name = E.key;
+		if (!name.begins_with("input/") || name.contains(".")) {
+			continue;
+		}
+
+		Dictionary action = get_setting_with_override(E.key);
+		float deadzone = action.get("deadzone", 0.5);
+		Array events = action.get("events", Array());
+		map.add_action(name.substr(6), deadzone, events);
+	}
+
+	uint32_t source_hash = settings_files_hash;
+	if (!p_settings_path.is_empty()) {
+		Vector<uint8_t> data = FileAccess::get_file_as_bytes(p_settings_path);
+		ERR_FAIL_COND_V_MSG(data.is_empty(), ERR_FILE_CANT_OPEN, "Couldn't read settings file '" + p_settings_path + "'.");
+		source_hash = hash_murmur3_buffer(data.ptr(), data.size());
+	}
+	return map.save(p_path.is_empty() ? get_compiled_input_map_path() : p_path, source_hash);
+}
+
+bool ProjectSettings::load_compiled_input_map(const String &p_path) {
+	_THREAD_SAFE_METHOD_
+
+	Error err = compiled_input_map.load(p_path.is_empty() ? get_compiled_input_map_path() : p_path, settings_files_hash);
+	if (err != OK && err != ERR_FILE_NOT_FOUND) {
+		print_verbose(vformat("ProjectSettings: Ignoring compiled input map (%s).", error_names[err]));
+	}
+	return err == OK;
+}
+
+// Size of the settings storage, compared with the previous layout that kept two full
+// Variants and unpacked flags per setting. Input actions and layer names are also
+// reported on their own, as they make up most of the settings of large projects.
+Dictionary ProjectSettings::get_memory_stats() const {
+	_THREAD_SAFE_METHOD_
+
+	constexpr uint64_t previous_container_size = 2 * sizeof(Variant) + 16;
+	// Each stored initial value is a separately allocated HashMap node. The bucket arrays
+	// (an element pointer and a hash per slot) are shared, so only the total counts them.
+	constexpr uint64_t stored_initial_size = sizeof(HashMapElement<StringName, Variant>);
+	const uint64_t initial_table_bytes = initial_values.is_empty() ? 0 : uint64_t(initial_values.get_capacity()) * (sizeof(HashMapElement<StringName, Variant> *) + sizeof(uint32_t));
+
+	auto make_stats = [&](const String &p_prefix) -> Dictionary {
+		uint64_t count = 0;
+		uint64_t stored_initials = 0;
+		for (const KeyValue<StringName, VariantContainer> &E : props) {
+			if (!p_prefix.is_empty() && !String(E.key).begins_with(p_prefix)) {
+				continue;
+			}
+			count++;
+			if (E.value.initial_stored) {
+				stored_initials++;
+			}
+		}
+
+		uint64_t bytes = count * sizeof(VariantContainer) + stored_initials * stored_initial_size;
+		if (p_prefix.is_empty()) {
+			bytes += initial_table_bytes;
+		}
+		uint64_t previous_bytes = count * previous_container_size;
+		Dictionary stats;
+		stats["settings"] = count;
+		stats["stored_initial_values"] = stored_initials;
+		stats["container_bytes"] = bytes;
+		stats["previous_container_bytes"] = previous_bytes;
+		stats["bytes_per_setting"] = count ? double(bytes) / count : 0.0;
+		stats["previous_bytes_per_setting"] = count ? double(previous_bytes) / count : 0.0;
+		return stats;
+	};
+
+	Dictionary stats = make_stats(String());
+	stats["container_size"] = uint64_t(sizeof(VariantContainer));
+	stats["previous_container_size"] = previous_container_size;
+	stats["initial_values_table_bytes"] = initial_table_bytes;
+	stats["input"] = make_stats("input/");
+	stats["layer_names"] = make_stats("layer_names/");
+
+	print_verbose(vformat("ProjectSettings: %d settings use %.1f bytes each, %.1f with the previous layout.", stats["settings"], stats["bytes_per_setting"], stats["previous_bytes_per_setting"]));
+	return stats;
+}
+
+// Objects of p_allowed_class (or inheriting it) and null objects are not counted.
+bool ProjectSettings::_variant_has_objects(const Variant &p_variant, const StringName &p_allowed_class) {
+	switch (p_variant.get_type()) {
+		case Variant::OBJECT: {
+			Object *object = p_variant.get_validated_object();
+			return object && (p_allowed_class == StringName() || !object->is_class(p_allowed_class));
+		}
+		case Variant::ARRAY: {
+			Array array = p_variant;
+			for (int i = 0; i < array.size(); i++) {
+				if (_variant_has_objects(array[i], p_allowed_class)) {
+					return true;
+				}
+			}
+			return false;
+		}
+		case Variant::DICTIONARY: {
+			Dictionary dict = p_variant;
+			Array keys = dict.keys();
+			for (int i = 0; i < keys.size(); i++) {
+				if (_variant_has_objects(keys[i], p_allowed_class) || _variant_has_objects(dict[keys[i]], p_allowed_class)) {
+					return true;
+				}
+			}
+			return false;
+		}
+		default: {
+			return false;
+		}
+	}
+}
+
+bool ProjectSettings::_is_frozen_inline(Variant::Type p_type) {
+	return p_type == Variant::NIL || p_type == Variant::BOOL || p_type == Variant::INT || p_type == Variant::FLOAT;
+}
+
+const ProjectSettings::FrozenSetting *ProjectSettings::_find_frozen_setting(const StringName &p_name) const {
+	const FrozenSetting *entries = reinterpret_cast<const FrozenSetting *>(frozen_arena.ptr());
+	uint32_t hash = p_name.hash();
+
+	uint32_t low = 0;
+	uint32_t high = frozen_count;
+	while (low < high) {
+		uint32_t mid = (low + high) / 2;
+		if (entries[mid].hash < hash) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	// StringNames are unique, so comparing data pointers compares names without reading
+	// (and reference counting) them.
+	const void *name = p_name.data_unique_pointer();
+	for (uint32_t i = low; i < frozen_count && entries[i].hash == hash; i++) {
+		if (entries[i].name == name) {
+			return &entries[i];
+		}
+	}
+	return nullptr;
+}
+
+// Compacts the settings (with feature overrides already applied) into a single immutable
+// block looked up without the settings lock. Meant for servers that fork workers after
+// loading the project: a read only reads the block and decodes into a new Variant, so the
+// pages stay shared between workers instead of being copied on write. Building the
+// caller's StringName from a String still goes through the StringName table, use static
+// StringNames on hot paths. Settings holding objects are left out and keep being read
+// from props. Must not be called while other threads read settings.
+Error ProjectSettings::freeze() {
+	_THREAD_SAFE_METHOD_
+
+	unfreeze();
+
+	LocalVector<FrozenSetting> entries;
+	LocalVector<uint8_t> values;
+
+	for (const KeyValue<StringName, VariantContainer> &E : props) {
+		if (String(E.key).contains(".")) {
+			continue; // Feature overrides are folded into their base setting.
+		}
+
+		Variant value = get_setting_with_override(E.key);
+		if (_variant_has_objects(value)) {
+			continue;
+		}
+
+		FrozenSetting entry;
+		entry.name = E.key.data_unique_pointer();
+		entry.hash = E.key.hash();
+		entry.type = value.get_type();
+		switch (value.get_type()) {
+			case Variant::NIL: {
+			} break;
+			case Variant::BOOL: {
+				entry.value.b = value;
+			} break;
+			case Variant::INT: {
+				entry.value.i = value;
+			} break;
+			case Variant::FLOAT: {
+				entry.value.f = value;
+			} break;
+			default: {
+				int size = 0;
+				Error err = encode_variant(value, nullptr, size, false);
+				ERR_CONTINUE(err != OK);
+				entry.value.encoded.offset = values.size();
+				entry.value.encoded.size = size;
+				values.resize(values.size() + size);
+				encode_variant(value, values.ptr() + entry.value.encoded.offset, size, false);
+			} break;
+		}
+		entries.push_back(entry);
+		frozen_names.push_back(E.key);
+	}
+
+	entries.sort();
+
+	uint32_t table_size = entries.size() * sizeof(FrozenSetting);
+	frozen_arena.resize(table_size + values.size());
+	for (FrozenSetting &entry : entries) {
+		if (!_is_frozen_inline(Variant::Type(entry.type))) {
+			entry.value.encoded.offset += table_size;
+		}
+	}
+	memcpy(frozen_arena.ptr(), entries.ptr(), table_size);
+	memcpy(frozen_arena.ptr() + table_size, values.ptr(), values.size());
+	frozen_count = entries.size();
+	frozen = true;
+
+	print_verbose(vformat("ProjectSettings: Froze %d settings into %d bytes.", frozen_count, frozen_arena.size()));
+	return OK;
+}
+
+// Like freeze(), must not be called while other threads read settings: readers don't
+// take the lock and would be left reading freed memory.
+void ProjectSettings::unfreeze() {
+	_THREAD_SAFE_METHOD_
+
+	frozen = false;
+	frozen_count = 0;
+	frozen_arena.reset();
+	frozen_names.reset();
+}
+
+bool ProjectSettings::_is_setting_saved(const StringName &p_name, const VariantContainer &p_container) const {
+	if (p_container.hide_from_editor) {
+		return false;
+	}
+	return p_container.persist || !p_container.has_initial || p_container.variant != _get_initial_value(p_name, p_container);
+}
+
+// Encodes text as UTF-8 into a fixed buffer that is written to the file in large
+// blocks. Values go through VariantWriter::write() straight into it, so a large value
+// (e.g. the input map) is never built up as one string first.
+class _SettingsFileSink {
+	static constexpr uint32_t BUFFER_SIZE = 64 * 1024;
+
+	Ref<FileAccess> file;
+	LocalVector<uint8_t> buffer;
+	uint32_t used = 0;
+
+	static Error _store_string(void *p_userdata, const String &p_string) {
+		static_cast<_SettingsFileSink *>(p_userdata)->store(p_string);
+		return OK;
+	}
+
+public:
+	void store(const char32_t *p_str, int p_len) {
+		for (int i = 0; i < p_len; i++) {
+			if (used + 4 > BUFFER_SIZE) {
+				flush();
+			}
+			uint32_t c = p_str[i];
+			uint8_t *dst = buffer.ptr() + used;
+			if (c < 0x80) {
+				dst[0] = c;
+				used += 1;
+			} else if (c < 0x800) {
+				dst[0] = 0xC0 | (c >> 6);
+				dst[1] = 0x80 | (c & 0x3F);
+				used += 2;
+			} else if (c < 0x10000) {
+				dst[0] = 0xE0 | (c >> 12);
+				dst[1] = 0x80 | ((c >> 6) & 0x3F);
+				dst[2] = 0x80 | (c & 0x3F);
+				used += 3;
+			} else {
+				dst[0] = 0xF0 | (c >> 18);
+				dst[1] = 0x80 | ((c >> 12) & 0x3F);
+				dst[2] = 0x80 | ((c >> 6) & 0x3F);
+				dst[3] = 0x80 | (c & 0x3F);
+				used += 4;
+			}
+		}
+	}
+
+	void store(const String &p_string) { store(p_string.ptr(), p_string.length()); }
+	void store_value(const Variant &p_value) { VariantWriter::write(p_value, &_store_string, this, nullptr, nullptr); }
+
+	void flush() {
+		if (used > 0) {
+			file->store_buffer(buffer.ptr(), used);
+			used = 0;
+		}
+	}
+
+	explicit _SettingsFileSink(const Ref<FileAccess> &p_file) :
+			file(p_file) {
+		buffer.resize(BUFFER_SIZE);
+	}
+
+	~_SettingsFileSink() {
+		flush();
+	}
+};
+
+Error ProjectSettings::_save_settings_text(const String &p_file, const RBMap<String, List<String>> &p_props, const CustomMap &p_custom, const String &p_custom_features) {
+	Error err;
+	Ref<FileAccess> file = FileAccess::open(p_file, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Couldn't save project.godot - " + p_file + ".");
+
+	_SettingsFileSink sink(file);
+	sink.store("; Engine configuration file.\n");
+	sink.store("; It's best edited using the editor UI and not directly,\n");
+	sink.store("; since the parameters that go here are not all obvious.\n");
+	sink.store(";\n");
+	sink.store("; Format:\n");
+	sink.store(";   [section] ; section goes between []\n");
+	sink.store(";   param=value ; assign values to parameters\n");
+	sink.store("\n");
+
+	sink.store("config_version=" + itos(CONFIG_VERSION) + "\n");
+	if (!p_custom_features.is_empty()) {
+		sink.store("custom_features=\"" + p_custom_features + "\"\n");
+	}
+	sink.store("\n");
+
+	for (const KeyValue<String, List<String>> &E : p_props) {
+		if (!E.key.is_empty()) {
+			sink.store("[" + E.key + "]\n\n");
+		}
+		for (const String &F : E.value) {
+			String key = F;
+			if (!E.key.is_empty()) {
+				key = E.key + "/" + key;
+			}
+			const Variant *custom = p_custom.getptr(key);
+
+			sink.store(F.property_name_encode());
+			sink.store("=");
+			sink.store_value(custom ? *custom : get(key));
+			sink.store("\n");
+		}
+	}
+
+	sink.flush();
+	file->flush();
+	ERR_FAIL_COND_V_MSG(file->get_error() != OK, ERR_FILE_CANT_WRITE, "Couldn't write project.godot - " + p_file + ".");
+	return OK;
+}
+
+// Location of a "key=value" entry in a settings text file, newline included.
+struct _SettingsTextEntry {
+	String section;
+	String key; // As written, i.e. property_name_encode()'d.
+	int start = 0;
+	int end = 0;
+};
+
+// Splits a settings text file into its entries, and the position right after the last
+// entry of each section (where new keys of that section go). Values are skipped over
+// by tracking strings and brackets, so multi-line values are kept in one piece.
+static void _scan_settings_text(const String &p_text, LocalVector<_SettingsTextEntry> &r_entries, HashMap<String, int> &r_section_ends) {
+	const char32_t *str = p_text.ptr();
+	int len = p_text.length();
+	String section;
+	int i = 0;
+
+	while (i < len) {
+		char32_t c = str[i];
+		if (c == '\n' || c == '\r' || c == ' ' || c == '\t') {
+			i++;
+			continue;
+		}
+
+		int line_start = i;
+		if (c == ';' || c == '#') {
+			while (i < len && str[i] != '\n') {
+				i++;
+			}
+			continue;
+		}
+
+		if (c == '[') {
+			int close = i;
+			while (close < len && str[close] != ']' && str[close] != '\n') {
+				close++;
+			}
+			section = p_text.substr(i + 1, close - i - 1);
+			while (i < len && str[i] != '\n') {
+				i++;
+			}
+			i = MIN(i + 1, len);
+			if (!r_section_ends.has(section)) {
+				r_section_ends[section] = i;
+			}
+			continue;
+		}
+
+		// Key, possibly quoted.
+		bool in_string = false;
+		while (i < len && (in_string || str[i] != '=') && str[i] != '\n') {
+			if (str[i] == '\\' && in_string) {
+				i++;
+			} else if (str[i] == '"') {
+				in_string = !in_string;
+			}
+			i++;
+		}
+		if (i >= len || str[i] != '=') {
+			continue; // Not an entry, skip the line.
+		}
+		String key = p_text.substr(line_start, i - line_start).strip_edges();
+
+		// Value, up to the first newline outside of strings and brackets.
+		int depth = 0;
+		in_string = false;
+		i++;
+		while (i < len) {
+			char32_t v = str[i];
+			if (in_string) {
+				if (v == '\\') {
+					i++;
+				} else if (v == '"') {
+					in_string = false;
+				}
+			} else if (v == '"') {
+				in_string = true;
+			} else if (v == '(' || v == '[' || v == '{') {
+				depth++;
+			} else if (v == ')' || v == ']' || v == '}') {
+				depth--;
+			} else if (v == '\n' && depth <= 0) {
+				break;
+			}
+			i++;
+		}
+		i = MIN(i + 1, len);
+
+		_SettingsTextEntry entry;
+		entry.section = section;
+		entry.key = key;
+		entry.start = line_start;
+		entry.end = i;
+		r_entries.push_back(entry);
+		r_section_ends[section] = i;
+	}
+}
+
+// Saves only the settings changed since the last save, by patching their lines in the
+// existing project.godot instead of regrouping and rewriting every setting. Falls back
+// to a full save() when the file is missing or was changed by someone else, or when the
+// sections of the file would change (a section is added or left empty, features changed).
+Error ProjectSettings::save_incremental() {
+	_THREAD_SAFE_METHOD_
+
+	String path = get_resource_path().path_join("project.godot");
+	bool full_save = dirty_layout || !FileAccess::exists(path) || FileAccess::get_modified_time(path) != last_save_time;
+
+	String text;
+	LocalVector<_SettingsTextEntry> entries;
+	HashMap<String, int> section_ends;
+	if (!full_save) {
+		if (dirty_settings.is_empty()) {
+			return OK;
+		}
+		Error err;
+		text = FileAccess::get_file_as_string(path, &err);
+		full_save = err != OK;
+		_scan_settings_text(text, entries, section_ends);
+	}
+
+	struct Edit {
+		int start = 0;
+		int end = 0;
+		String key; // Empty if the entry is removed.
+		const Variant *value = nullptr;
+		int order = 0; // Keeps appended keys in a stable order.
+
+		bool operator<(const Edit &p_other) const { return start != p_other.start ? start < p_other.start : order < p_other.order; }
+	};
+	LocalVector<Edit> edits;
+
+	if (!full_save) {
+		HashMap<String, uint32_t> entry_indices;
+		HashMap<String, int> section_sizes;
+		for (uint32_t i = 0; i < entries.size(); i++) {
+			entry_indices[entries[i].section + "\n" + entries[i].key] = i;
+			section_sizes[entries[i].section]++;
+		}
+
+		for (const StringName &name : dirty_settings) {
+			String category = name;
+			String key = category;
+			int div = category.find("/");
+			if (div < 0) {
+				category = "";
+			} else {
+				category = category.substr(0, div);
+				key = key.substr(div + 1);
+			}
+			key = key.property_name_encode();
+
+			const VariantContainer *container = props.getptr(name);
+			bool saved = container && _is_setting_saved(name, *container);
+
+			Edit edit;
+			edit.order = edits.size();
+			if (saved) {
+				edit.key = key;
+				edit.value = &container->variant;
+			}
+
+			const uint32_t *index = entry_indices.getptr(category + "\n" + key);
+			if (index) {
+				edit.start = entries[*index].start;
+				edit.end = entries[*index].end;
+				if (!saved) {
+					section_sizes[category]--;
+				}
+			} else if (!saved) {
+				continue;
+			} else if (section_ends.has(category)) {
+				edit.start = section_ends[category];
+				edit.end = edit.start;
+				section_sizes[category]++;
+			} else {
+				full_save = true; // New section.
+				break;
+			}
+			edits.push_back(edit);
+		}
+
+		for (const KeyValue<String, int> &E : section_sizes) {
+			if (E.value <= 0 && !E.key.is_empty()) {
+				full_save = true; // Section left empty.
+				break;
+			}
+		}
+	}
+
+	if (full_save) {
+		Error err = save();
+		if (err == OK) {
+			dirty_settings.clear();
+			dirty_layout = false;
+		}
+		return err;
+	}
+
+	edits.sort();
+
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+	ERR_FAIL_COND_V_MSG(file.is_null(), ERR_FILE_CANT_WRITE, "Couldn't save project.godot.");
+	{
+		_SettingsFileSink sink(file);
+		int copied = 0;
+		for (const Edit &edit : edits) {
+			sink.store(text.ptr() + copied, edit.start - copied);
+			if (!edit.key.is_empty()) {
+				sink.store(edit.key);
+				sink.store("=");
+				sink.store_value(*edit.value);
+				sink.store("\n");
+			}
+			copied = edit.end;
+		}
+		sink.store(text.ptr() + copied, text.length() - copied);
+	}
+	file.unref();
+
+	print_verbose(vformat("ProjectSettings: Saved %d changed settings incrementally.", dirty_settings.size()));
+	last_save_time = FileAccess::get_modified_time(path);
+	dirty_settings.clear();
+	return OK;
+}
+
+// Copies what save() would write, in the same order. Values are duplicated deeply, so
+// the copy can be serialized on another thread while the settings keep changing.
+ProjectSettings::SaveSnapshot *ProjectSettings::_make_save_snapshot(const String &p_path) const {
+	SaveSnapshot *snapshot = memnew(SaveSnapshot);
+	snapshot->path = p_path;
+
+	for (const String &feature : custom_features) {
+		if (!snapshot->custom_features.is_empty()) {
+			snapshot->custom_features += ",";
+		}
+		snapshot->custom_features += feature;
+	}
+
+	RBSet<_VCSort> vclist;
+	for (const KeyValue<StringName, VariantContainer> &E : props) {
+		if (!_is_setting_saved(E.key, E.value)) {
+			continue;
+		}
+		_VCSort vc;
+		vc.name = E.key;
+		vc.order = E.value.order;
+		vclist.insert(vc);
+		snapshot->values[vc.name] = E.value.variant.duplicate(true);
+	}
+
+	for (const _VCSort &E : vclist) {
+		String category = E.name;
+		String name = E.name;
+		int div = category.find("/");
+		if (div < 0) {
+			category = "";
+		} else {
+			category = category.substr(0, div);
+			name = name.substr(div + 1);
+		}
+		snapshot->sections[category].push_back(name);
+	}
+
+	snapshot->dirty_settings = dirty_settings;
+	snapshot->dirty_layout = dirty_layout;
+	return snapshot;
+}
+
+// Writes to a temporary file first and renames it over the target, so a crash or a full
+// disk never leaves a truncated project.godot behind. The file is flushed before the
+// rename, but FileAccess has no fsync: after a power loss the new content may still not
+// have reached the disk. All values come from the snapshot, so the settings themselves
+// are not touched from the worker thread.
+Error ProjectSettings::_write_save_snapshot(const SaveSnapshot &p_snapshot) {
+	String tmp_path = p_snapshot.path + ".tmp";
+	Error err = p_snapshot.settings->_save_settings_text(tmp_path, p_snapshot.sections, p_snapshot.values, p_snapshot.custom_features);
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Couldn't save project settings to '" + tmp_path + "'.");
+
+	Ref<DirAccess> dir = DirAccess::create_for_path(tmp_path);
+	ERR_FAIL_COND_V(dir.is_null(), ERR_CANT_CREATE);
+	err = dir->rename(tmp_path, p_snapshot.path);
+	if (err != OK) {
+		dir->remove(tmp_path);
+	}
+	ERR_FAIL_COND_V_MSG(err != OK, err, "Couldn't replace '" + p_snapshot.path + "'.");
+	return OK;
+}
+
+void ProjectSettings::_async_save_task(void *p_userdata) {
+	SaveSnapshot *snapshot = static_cast<SaveSnapshot *>(p_userdata);
+	snapshot->result = _write_save_snapshot(*snapshot);
+	callable_mp(snapshot->settings, &ProjectSettings::_async_save_finished).call_deferred(snapshot->id);
+}
+
+// Call with async_save_mutex held.
+void ProjectSettings::_start_async_save(SaveSnapshot *p_snapshot) {
+	p_snapshot->settings = this;
+	p_snapshot->id = ++async_save_count;
+	async_save_current = p_snapshot;
+	async_save_task = WorkerThreadPool::get_singleton()->add_native_task(&ProjectSettings::_async_save_task, p_snapshot, false, "Save project settings");
+}
+
+void ProjectSettings::_async_save_finished(uint64_t p_id) {
+	Error result;
+	String path;
+	HashSet<StringName> unsaved_settings;
+	bool unsaved_layout = false;
+	{
+		MutexLock lock(async_save_mutex);
+		if (!async_save_current || async_save_current->id != p_id) {
+			return; // Already finished by wait_for_async_save().
+		}
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(async_save_task);
+		result = async_save_current->result;
+		path = async_save_current->path;
+		if (result != OK) {
+			unsaved_settings = async_save_current->dirty_settings;
+			unsaved_layout = async_save_current->dirty_layout;
+		}
+		memdelete(async_save_current);
+		async_save_current = nullptr;
+		async_save_task = WorkerThreadPool::INVALID_TASK_ID;
+
+		if (async_save_pending) {
+			SaveSnapshot *pending = async_save_pending;
+			async_save_pending = nullptr;
+			_start_async_save(pending);
+		}
+	}
+
+	{
+		_THREAD_SAFE_METHOD_
+		if (result == OK) {
+			last_save_time = FileAccess::get_modified_time(path);
+		} else {
+			// Keep the changes for the next (incremental) save.
+			for (const StringName &name : unsaved_settings) {
+				dirty_settings.insert(name);
+			}
+			dirty_layout = dirty_layout || unsaved_layout;
+		}
+	}
+	emit_signal("settings_saved", result);
+}
+
+// Saves project.godot on a worker thread, emitting "settings_saved" once the file is
+// written. If a save is still running, only the latest requested state is saved after
+// it, so saving often costs at most one extra write.
+Error ProjectSettings::save_async() {
+	SaveSnapshot *snapshot = nullptr;
+	{
+		_THREAD_SAFE_METHOD_
+		snapshot = _make_save_snapshot(get_resource_path().path_join("project.godot"));
+		dirty_settings.clear();
+		dirty_layout = false;
+	}
+
+	MutexLock lock(async_save_mutex);
+	if (async_save_current) {
+		if (async_save_pending) {
+			// The newer snapshot includes these changes, it has to remember them in case it fails.
+			for (const StringName &name : async_save_pending->dirty_settings) {
+				snapshot->dirty_settings.insert(name);
+			}
+			snapshot->dirty_layout = snapshot->dirty_layout || async_save_pending->dirty_layout;
+			memdelete(async_save_pending);
+		}
+		async_save_pending = snapshot;
+	} else {
+		_start_async_save(snapshot);
+	}
+	return OK;
+}
+
+void ProjectSettings::wait_for_async_save() {
+	while (true) {
+		uint64_t id = 0;
+		{
+			MutexLock lock(async_save_mutex);
+			if (!async_save_current) {
+				return;
+			}
+			id = async_save_current->id;
+		}
+		_async_save_finished(id);
+	}
+}
+
+bool ProjectSettings::is_async_save_running() const {
+	MutexLock lock(async_save_mutex);
+	return async_save_current != nullptr;
+}
+
+Error ProjectSettings::_load_settings_text(const String &p_path) {
+	Error err;
+	// Read at once, so the content hash used to cache the conversion comes for free.
+	Vector<uint8_t> data = FileAccess::get_file_as_bytes(p_path, &err);
+	if (err != OK) {
+		// FIXME: Above 'err' error code is ERR_FILE_CANT_OPEN if the file is missing
+		// This needs to be streamlined if we want decent error reporting
+		return ERR_FILE_NOT_FOUND;
+	}
+	uint32_t source_hash = hash_murmur3_buffer(data.ptr(), data.size());
+	_add_settings_file_hash(source_hash);
+
+	VariantParser::StreamString stream;
+	stream.s = String::utf8(reinterpret_cast<const char *>(data.ptr()), data.size());
+
+	String assign;
+	Variant value;
+	VariantParser::Tag next_tag;
+
+	int lines = 0;
+	String error_text;
+	String section;
+	int config_version = 0;
+
+	while (true) {
+		assign = Variant();
+		next_tag.fields.clear();
+		next_tag.name = String();
+
+		err = VariantParser::parse_tag_assign_eof(&stream, lines, error_text, next_tag, assign, value, nullptr, true);
+		if (err == ERR_FILE_EOF) {
+			// If we're loading a project.godot from source code, we can operate some
+			// ProjectSettings conversions if need be.
+			_convert_to_last_version(config_version, source_hash);
+			last_save_time = FileAccess::get_modified_time(get_resource_path().path_join("project.godot"));
+			return OK;
+		}
+		ERR_FAIL_COND_V_MSG(err != OK, err, vformat("Error parsing '%s' at line %d: %s File might be corrupted.", p_path, lines, error_text));
+
+		if (!assign.is_empty()) {
+			if (section.is_empty() && assign == "config_version") {
+				config_version = value;
+				ERR_CONTINUE_MSG(config_version > CONFIG_VERSION, vformat("Can't open project at '%s', its `config_version` (%d) is from a more recent and incompatible version of the engine. Expected config version: %d.", p_path, config_version, CONFIG_VERSION));
+			} else {
+				if (section.is_empty()) {
+					set(assign, value);
+				} else {
+					set(section + "/" + assign, value);
+				}
+			}
+		} else if (!next_tag.name.is_empty()) {
+			section = next_tag.name;
+		}
+	}
+}
+
+Error ProjectSettings::_load_settings_binary(const String &p_path) {
+	Error err;
+	Vector<uint8_t> data = FileAccess::get_file_as_bytes(p_path, &err);
+	if (err != OK) {
+		return err;
+	}
+	_add_settings_file_hash(hash_murmur3_buffer(data.ptr(), data.size()));
+
+	const uint8_t *r = data.ptr();
+	uint64_t length = data.size();
+	ERR_FAIL_COND_V_MSG(length < 8 || r[0] != 'E' || r[1] != 'C' || r[2] != 'F' || r[3] != 'G', ERR_FILE_CORRUPT, "Corrupted header in binary project.binary (not ECFG).");
+
+	uint32_t count = decode_uint32(r + 4);
+	uint64_t pos = 8;
+
+	for (uint32_t i = 0; i < count; i++) {
+		ERR_FAIL_COND_V(pos + 4 > length, ERR_FILE_CORRUPT);
+		uint32_t slen = decode_uint32(r + pos);
+		pos += 4;
+		ERR_FAIL_COND_V(pos + slen + 4 > length, ERR_FILE_CORRUPT);
+		String key = String::utf8(reinterpret_cast<const char *>(r + pos), slen);
+		pos += slen;
+
+		uint32_t vlen = decode_uint32(r + pos);
+		pos += 4;
+		ERR_FAIL_COND_V(pos + vlen > length, ERR_FILE_CORRUPT);
+		Variant value;
+		err = decode_variant(value, r + pos, vlen, nullptr, true);
+		pos += vlen;
+		ERR_CONTINUE_MSG(err != OK, "Error decoding property: " + key + ".");
+		set(key, value);
+	}
+
+	return OK;
+}
+
+// Settings converters, run on the settings of projects saved with an older config_version.
+// Each one is applied to the settings starting with its prefix and returns whether it
+// changed the value.
+typedef bool (*SettingsConverter)(const StringName &p_name, Variant &r_value);
+
+struct SettingsMigration {
+	int last_version; // Applied to projects with this config_version or older.
+	const char *prefix;
+	SettingsConverter convert;
+};
+
+// Actions used to be an array of events, now a dictionary with deadzone and events.
+static bool _migrate_input_action_array(const StringName &p_name, Variant &r_value) {
+	if (r_value.get_type() != Variant::ARRAY) {
+		return false;
+	}
+	Dictionary action;
+	action["deadzone"] = Variant(0.5f);
+	action["events"] = r_value;
+	r_value = action;
+	return true;
+}
+
+static const SettingsMigration settings_migrations[] = {
+	{ 3, "input/", _migrate_input_action_array },
+};
+
+static constexpr uint32_t MIGRATION_CACHE_MAGIC = 0x474D4447; // "GDMG"
+
+String ProjectSettings::_get_migration_cache_path() const {
+	return get_project_data_path().path_join("migrated_settings.bin");
+}
+
+bool ProjectSettings::_load_migration_cache(uint32_t p_source_hash) {
+	Ref<FileAccess> file = FileAccess::open(_get_migration_cache_path(), FileAccess::READ);
+	if (file.is_null()) {
+		return false;
+	}
+	if (file->get_32() != MIGRATION_CACHE_MAGIC || file->get_32() != uint32_t(CONFIG_VERSION) || file->get_32() != p_source_hash) {
+		return false;
+	}
+
+	uint32_t count = file->get_32();
+	LocalVector<Pair<StringName, Variant>> migrated;
+	migrated.reserve(count);
+	Vector<uint8_t> buffer;
+	for (uint32_t i = 0; i < count; i++) {
+		String name = file->get_pascal_string();
+		uint32_t size = file->get_32();
+		ERR_FAIL_COND_V(file->eof_reached() || size > file->get_length() - file->get_position(), false);
+
+		buffer.resize(size);
+		file->get_buffer(buffer.ptrw(), size);
+		// Only input actions may hold objects, and only input events.
+		bool input = name.begins_with("input/");
+		Variant value;
+		Error err = decode_variant(value, buffer.ptr(), size, nullptr, input);
+		ERR_FAIL_COND_V_MSG(err != OK || (input && _variant_has_objects(value, SNAME("InputEvent"))), false, "Settings migration cache is corrupt, ignoring it.");
+		migrated.push_back(Pair<StringName, Variant>(name, value));
+	}
+
+	for (const Pair<StringName, Variant> &E : migrated) {
+		if (props.has(E.first)) {
+			_set_variant(E.first, props[E.first], E.second);
+		}
+	}
+	print_verbose(vformat("ProjectSettings: Applied %d migrated settings from the cache.", migrated.size()));
+	return true;
+}
+
+void ProjectSettings::_save_migration_cache(uint32_t p_source_hash, const LocalVector<Pair<StringName, Variant>> &p_migrated) {
+	for (const Pair<StringName, Variant> &E : p_migrated) {
+		if (_variant_has_objects(E.second, String(E.first).begins_with("input/") ? SNAME("InputEvent") : StringName())) {
+			return; // Wouldn't be accepted by _load_migration_cache().
+		}
+	}
+
+	Ref<FileAccess> file = FileAccess::open(_get_migration_cache_path(), FileAccess::WRITE);
+	if (file.is_null()) {
+		return; // Read-only project (e.g. exported), it is converted on each load then.
+	}
+
+	file->store_32(MIGRATION_CACHE_MAGIC);
+	file->store_32(CONFIG_VERSION);
+	file->store_32(p_source_hash);
+	file->store_32(p_migrated.size());
+
+	Vector<uint8_t> buffer;
+	for (const Pair<StringName, Variant> &E : p_migrated) {
+		int size = 0;
+		encode_variant(E.second, nullptr, size, true);
+		buffer.resize(size);
+		encode_variant(E.second, buffer.ptrw(), size, true);
+
+		file->store_pascal_string(E.first);
+		file->store_32(size);
+		file->store_buffer(buffer.ptr(), size);
+	}
+}
+
+// Brings the settings of an older project up to CONFIG_VERSION. The settings the
+// converters apply to are gathered in one pass over props, every converter then runs
+// over that batch, and the results are written back once. The results are also cached
+// next to the project under the hash of the file the loader read, so later loads of the
+// same unsaved project apply the cached values without converting again.
+void ProjectSettings::_convert_to_last_version(int p_from_version, uint32_t p_source_hash) {
+	if (p_from_version >= CONFIG_VERSION) {
+		return;
+	}
+
+	uint32_t cache_key = hash_murmur3_one_32(uint32_t(p_from_version), p_source_hash);
+	if (p_source_hash != 0 && _load_migration_cache(cache_key)) {
+		return;
+	}
+
+	LocalVector<const SettingsMigration *> migrations;
+	for (const SettingsMigration &migration : settings_migrations) {
+		if (p_from_version <= migration.last_version) {
+			migrations.push_back(&migration);
+		}
+	}
+	if (migrations.is_empty()) {
+		return;
+	}
+
+	LocalVector<Pair<StringName, Variant>> batch;
+	for (const KeyValue<StringName, VariantContainer> &E : props) {
+		String name = E.key;
+		for (const SettingsMigration *migration : migrations) {
+			if (name.begins_with(migration->prefix)) {
+				batch.push_back(Pair<StringName, Variant>(E.key, E.value.variant));
+				break;
+			}
+		}
+	}
+
+	LocalVector<bool> changed;
+	changed.resize(batch.size());
+	for (uint32_t i = 0; i < batch.size(); i++) {
+		changed[i] = false;
+	}
+	for (const SettingsMigration *migration : migrations) {
+		for (uint32_t i = 0; i < batch.size(); i++) {
+			if (String(batch[i].first).begins_with(migration->prefix) && migration->convert(batch[i].first, batch[i].second)) {
+				changed[i] = true;
+			}
+		}
+	}
+
+	LocalVector<Pair<StringName, Variant>> migrated;
+	for (uint32_t i = 0; i < batch.size(); i++) {
+		if (changed[i]) {
+			_set_variant(batch[i].first, props[batch[i].first], batch[i].second);
+			migrated.push_back(batch[i]);
+		}
+	}
+
+	print_verbose(vformat("ProjectSettings: Migrated %d settings from config_version %d.", migrated.size(), p_from_version));
+	if (p_source_hash != 0) {
+		_save_migration_cache(cache_key, migrated);
+	}
+}
+
+// Peak resident set size of the process in bytes, or 0 where it can't be read.
+static uint64_t _get_peak_rss() {
+#ifdef __linux__
+	Ref<FileAccess> f = FileAccess::open("/proc/self/status", FileAccess::READ);
+	if (f.is_valid()) {
+		while (!f->eof_reached()) {
+			String line = f->get_line();
+			if (line.begins_with("VmHWM:")) {
+				return line.get_slicec(':', 1).strip_edges().get_slicec(' ', 0).to_int() * 1024; // In kB.
+			}
+		}
+	}
+#endif
+	return 0;
+}
+
+// Reports what loading the project cost. Every settings node taken from the arena would
+// otherwise have been its own heap allocation, so the node counts compare loading
+// without the arena (before) and with it (after).
+struct _SetupAllocationReport {
+	SettingsArena::Stats arena_before = SettingsArena::get_stats();
+	uint64_t peak_rss_before = _get_peak_rss();
+	uint64_t usec_before = OS::get_singleton()->get_ticks_usec();
+
+	~_SetupAllocationReport() {
+		SettingsArena::Stats arena_after = SettingsArena::get_stats();
+		uint64_t arena_nodes = arena_after.arena_allocations - arena_before.arena_allocations;
+		uint64_t heap_nodes = arena_after.heap_allocations - arena_before.heap_allocations;
+		uint64_t chunks = arena_after.chunks - arena_before.chunks;
+		uint64_t peak_rss_after = _get_peak_rss();
+
+		print_verbose(vformat("ProjectSettings: Loaded in %d usec. Settings node allocations: %d without the arena, %d with it (%d nodes taking %s in %d chunks, %d from heap). Peak RSS: %s -> %s.",
+				OS::get_singleton()->get_ticks_usec() - usec_before,
+				arena_nodes + heap_nodes,
+				chunks + heap_nodes,
+				arena_nodes,
+				String::humanize_size(arena_after.arena_bytes - arena_before.arena_bytes),
+				chunks,
+				heap_nodes,
+				peak_rss_before ? String::humanize_size(peak_rss_before) : String("unknown"),
+				peak_rss_after ? String::humanize_size(peak_rss_after) : String("unknown")));
+	}
+};
+
+Error ProjectSettings::_setup(const String &p_path, const String &p_main_pack, bool p_upwards, bool p_ignore_override) {
+	// Declared first so it reports after the arena scope has ended.
+	_SetupAllocationReport allocation_report;
+	SettingsArena::Scope arena_scope;
+
 	if (!OS::get_singleton()->get_resource_dir().is_empty()) {
 		// OS will call ProjectSettings->get_resource_path which will be empty if not overridden!
 		// If the OS would rather use a specific location, then it will not be empty.
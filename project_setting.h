@@ -1,15 +1,72 @@
 #ifndef PROJECT_SETTINGS_H
 #define PROJECT_SETTINGS_H
 
+#include "core/config/compiled_input_map.h"
+#include "core/config/global_class_registry.h"
 #include "core/object/class_db.h"
+#include "core/object/ref_counted.h"
+#include "core/object/worker_thread_pool.h"
+#include "core/templates/safe_refcount.h"
+
+class Resource;
 
 template <typename T>
 class TypedArray;
 
+// Allocator for the settings map. While a SettingsArena::Scope is active on the calling
+// thread, nodes are carved out of large chunks instead of one heap block each. Freeing
+// an arena node is a no-op; the chunks are released as a unit once no node is left.
+// Heap allocations take no lock. The arena lock is only taken to carve a node, which
+// only happens while loading, and to free a node while chunks are alive, which only
+// happens when settings are erased.
+class SettingsArena {
+	struct alignas(16) Chunk {
+		Chunk *next = nullptr;
+		size_t size = 0;
+		size_t used = 0;
+	};
+
+	static constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+	static Chunk *chunks;
+	static uint64_t live_allocations;
+	static thread_local bool active;
+	static SafeFlag has_chunks;
+	static SafeNumeric<uint64_t> heap_allocations;
+
+	static bool _owns(const void *p_ptr);
+	static void _release();
+
+public:
+	struct Stats {
+		uint64_t arena_allocations = 0;
+		uint64_t heap_allocations = 0;
+		uint64_t arena_bytes = 0;
+		uint64_t chunks = 0;
+	};
+
+	class Scope {
+		bool prev_active = false;
+
+	public:
+		Scope();
+		~Scope();
+	};
+
+	static void *alloc(size_t p_memory);
+	static void free(void *p_ptr);
+
+	static Stats get_stats();
+
+private:
+	static Stats stats;
+};
+
 class ProjectSettings : public Object {
 	GDCLASS(ProjectSettings, Object);
 	_THREAD_SAFE_CLASS_
 	friend class TestProjectSettingsInternalsAccessor;
+	friend class EngineContext;
 
 	bool is_changed = false;
 
@@ -31,53 +88,172 @@ public:
 		StringName name;
 		String path;
 		bool is_singleton = false;
+		// Autoloads whose resources must be loaded before this one's (set through the
+		// "autoload_dependencies/<name>" setting).
+		Vector<StringName> dependencies;
 	};
 
 protected:
+	// One per setting, so kept small: flags are packed, and the initial value is only
+	// stored (in initial_values) once it differs from the current value. There is no
+	// `initial` member anymore, read it with _get_initial_value(). `variant` of an
+	// existing setting must only be changed through _set_variant(), which moves the
+	// initial value aside first.
 	struct VariantContainer {
-		int order = 0;
-		bool persist = false;
-		bool basic = false;
-		bool internal = false;
 		Variant variant;
-		Variant initial;
-		bool hide_from_editor = false;
-		bool restart_if_changed = false;
+		int order = 0;
+		bool persist : 1;
+		bool basic : 1;
+		bool internal : 1;
+		bool hide_from_editor : 1;
+		bool restart_if_changed : 1;
+		bool has_initial : 1;
+		bool initial_stored : 1; // If not set, the initial value is the current one.
 #ifdef DEBUG_METHODS_ENABLED
-		bool ignore_value_in_docs = false;
+		bool ignore_value_in_docs : 1;
 #endif
 
-		VariantContainer() {}
+		VariantContainer() :
+				persist(false),
+				basic(false),
+				internal(false),
+				hide_from_editor(false),
+				restart_if_changed(false),
+				has_initial(false),
+				initial_stored(false)
+#ifdef DEBUG_METHODS_ENABLED
+				,
+				ignore_value_in_docs(false)
+#endif
+		{
+		}
 
 		VariantContainer(const Variant &p_variant, int p_order, bool p_persist = false) :
-				order(p_order),
-				persist(p_persist),
-				variant(p_variant) {
+				VariantContainer() {
+			variant = p_variant;
+			order = p_order;
+			persist = p_persist;
 		}
 	};
 
+	HashMap<StringName, Variant> initial_values;
+
+	Variant _get_initial_value(const StringName &p_name, const VariantContainer &p_container) const;
+	void _set_variant(const StringName &p_name, VariantContainer &p_container, const Variant &p_value);
+
 	int last_order = NO_BUILTIN_ORDER_BASE;
 	int last_builtin_order = 0;
 	uint64_t last_save_time = 0;
+	// Content hash of the settings file loaded, combined with the ones loaded after it
+	// (e.g. override.cfg). Identifies what the compiled input map must be built from.
+	uint32_t settings_files_hash = 0;
+	void _add_settings_file_hash(uint32_t p_hash);
 
-	RBMap<StringName, VariantContainer> props; // NOTE: Key order is used e.g. in the save_custom method.
+	// Settings changed since the last save, for save_incremental().
+	HashSet<StringName> dirty_settings;
+	bool dirty_layout = false;
+
+	bool _is_setting_saved(const StringName &p_name, const VariantContainer &p_container) const;
+
+	struct SaveSnapshot {
+		String path;
+		String custom_features;
+		RBMap<String, List<String>> sections;
+		CustomMap values;
+		HashSet<StringName> dirty_settings; // Restored if the save fails.
+		bool dirty_layout = false;
+
+		ProjectSettings *settings = nullptr;
+		uint64_t id = 0;
+		Error result = OK;
+	};
+
+	mutable Mutex async_save_mutex;
+	SaveSnapshot *async_save_current = nullptr;
+	SaveSnapshot *async_save_pending = nullptr; // Replaced by newer requests until the current save finishes.
+	WorkerThreadPool::TaskID async_save_task = WorkerThreadPool::INVALID_TASK_ID;
+	uint64_t async_save_count = 0;
+
+	SaveSnapshot *_make_save_snapshot(const String &p_path) const;
+	static Error _write_save_snapshot(const SaveSnapshot &p_snapshot);
+	static void _async_save_task(void *p_userdata);
+	void _start_async_save(SaveSnapshot *p_snapshot);
+	void _async_save_finished(uint64_t p_id);
+
+	RBMap<StringName, VariantContainer, Comparator<StringName>, SettingsArena> props; // NOTE: Key order is used e.g. in the save_custom method.
 	String resource_path;
 	HashMap<StringName, PropertyInfo> custom_prop_info;
 	bool using_datapack = false;
 	bool project_loaded = false;
 	List<String> input_presets;
+	CompiledInputMap compiled_input_map;
 
 	HashSet<String> custom_features;
 	HashMap<StringName, LocalVector<Pair<StringName, StringName>>> feature_overrides;
 
 	LocalVector<String> hidden_prefixes;
 	HashMap<StringName, AutoloadInfo> autoloads;
+	HashMap<StringName, Vector<StringName>> autoload_dependencies;
+
+	// Autoloads sorted by the order of their settings, i.e. the order they are added to
+	// the tree in. Kept up to date as autoloads are added and removed.
+	struct OrderedAutoload {
+		StringName name;
+		int order = 0;
+	};
+	LocalVector<OrderedAutoload> autoload_table;
+	HashMap<StringName, uint32_t> autoload_table_indices;
+
+	void _add_to_autoload_table(const StringName &p_name, int p_order);
+	void _remove_from_autoload_table(const StringName &p_name);
+	void _reindex_autoload_table(uint32_t p_from);
+	void _sort_autoload_table();
 	HashMap<StringName, String> global_groups;
 	HashMap<StringName, HashSet<StringName>> scene_groups_cache;
+	mutable HashMap<StringName, HashSet<StringName>> scene_groups_index; // Group to the scenes using it.
+	mutable bool scene_groups_index_valid = false;
+
+	void _rebuild_scene_groups_index() const;
+	void _update_scene_groups_index(const StringName &p_path, const HashSet<StringName> *p_old_groups, const HashSet<StringName> *p_new_groups);
 
 	Array global_class_list;
 	bool is_global_class_list_loaded = false;
 
+	// Index of global_class_list, rebuilt when the list is replaced by another array (as
+	// store_global_class_list() does). Editing the stored array in place is not supported,
+	// store the edited list instead.
+	GlobalClassRegistry global_class_registry;
+	const void *global_class_registry_source = nullptr;
+
+	void _update_global_class_registry();
+
+	// Frozen settings: a sorted table of entries followed by the encoded values, all in one
+	// allocation that is never written to after freeze(). Scalars are stored in the entry.
+	struct FrozenSetting {
+		const void *name = nullptr; // StringName data, kept alive by frozen_names.
+		uint32_t hash = 0;
+		uint32_t type = Variant::NIL;
+		union {
+			bool b;
+			int64_t i;
+			double f;
+			struct {
+				uint32_t offset;
+				uint32_t size;
+			} encoded;
+		} value = {};
+
+		bool operator<(const FrozenSetting &p_other) const { return hash < p_other.hash; }
+	};
+	LocalVector<uint8_t> frozen_arena;
+	LocalVector<StringName> frozen_names;
+	uint32_t frozen_count = 0;
+	bool frozen = false;
+
+	static bool _is_frozen_inline(Variant::Type p_type);
+	const FrozenSetting *_find_frozen_setting(const StringName &p_name) const;
+	static bool _variant_has_objects(const Variant &p_variant, const StringName &p_allowed_class = StringName());
+
 	String project_data_dir_name;
 
 	bool _set(const StringName &p_name, const Variant &p_value);
@@ -90,6 +266,10 @@ protected:
 	void _emit_changed();
 
 	static ProjectSettings *singleton;
+	static thread_local ProjectSettings *context_singleton;
+
+	// Settings not found here are looked up in the parent (used by engine contexts).
+	ProjectSettings *parent_settings = nullptr;
 
 	Error _load_settings_text(const String &p_path);
 	Error _load_settings_binary(const String &p_path);
@@ -105,7 +285,11 @@ protected:
 	const static PackedStringArray _trim_to_supported_features(const PackedStringArray &p_project_features);
 #endif // TOOLS_ENABLED
 
-	void _convert_to_last_version(int p_from_version);
+	// p_source_hash is the content hash of the loaded settings file, 0 to not cache the result.
+	void _convert_to_last_version(int p_from_version, uint32_t p_source_hash);
+	String _get_migration_cache_path() const;
+	bool _load_migration_cache(uint32_t p_source_hash);
+	void _save_migration_cache(uint32_t p_source_hash, const LocalVector<Pair<StringName, Variant>> &p_migrated);
 
 	bool _load_resource_pack(const String &p_pack, bool p_replace_files = true, int p_offset = 0);
 
@@ -128,6 +312,16 @@ public:
 	void store_global_class_list(const Array &p_classes);
 	String get_global_class_list_path() const;
 
+	String get_global_class_list_binary_path() const;
+	Error store_global_class_list_binary();
+	bool load_global_class_list_binary();
+
+	void add_global_class(const Dictionary &p_class);
+	void remove_global_class(const StringName &p_class);
+	bool get_global_class_info(const StringName &p_class, GlobalClassRegistry::ClassInfo &r_info);
+	StringName get_global_class_name_for_path(const String &p_path);
+	Vector<StringName> get_global_class_inheriters(const StringName &p_base);
+
 	bool has_setting(const String &p_var) const;
 	String localize_path(const String &p_path) const;
 	String globalize_path(const String &p_path) const;
@@ -158,14 +352,30 @@ public:
 	Error load_custom(const String &p_path);
 	Error save_custom(const String &p_path = "", const CustomMap &p_custom = CustomMap(), const Vector<String> &p_custom_features = Vector<String>(), bool p_merge_with_current = true);
 	Error save();
+	Error save_incremental();
+	Error save_async();
+	void wait_for_async_save();
+	bool is_async_save_running() const;
 	void set_custom_property_info(const PropertyInfo &p_info);
 	const HashMap<StringName, PropertyInfo> &get_custom_property_info() const;
 	uint64_t get_last_saved_time() { return last_save_time; }
 
 	List<String> get_input_presets() const { return input_presets; }
 
+	String get_compiled_input_map_path() const;
+	Error save_compiled_input_map(const String &p_path = "", const String &p_settings_path = "");
+	bool load_compiled_input_map(const String &p_path = "");
+	bool has_compiled_input_map() const { return compiled_input_map.get_action_count() > 0; }
+	const CompiledInputMap &get_compiled_input_map() const { return compiled_input_map; }
+
 	Variant get_setting_with_override(const StringName &p_name) const;
 
+	Dictionary get_memory_stats() const;
+
+	Error freeze();
+	void unfreeze();
+	bool is_frozen() const { return frozen; }
+
 	bool is_using_datapack() const;
 	bool is_project_loaded() const;
 
@@ -176,6 +386,11 @@ public:
 	void remove_autoload(const StringName &p_autoload);
 	bool has_autoload(const StringName &p_autoload) const;
 	AutoloadInfo get_autoload(const StringName &p_name) const;
+	uint32_t get_autoload_count() const { return autoload_table.size(); }
+	const StringName &get_autoload_name(uint32_t p_index) const { return autoload_table[p_index].name; }
+	int get_autoload_index(const StringName &p_name) const;
+	Vector<Vector<StringName>> get_autoload_load_waves() const;
+	void preload_autoloads(HashMap<StringName, Ref<Resource>> &r_resources);
 
 	const HashMap<StringName, String> &get_global_groups_list() const;
 	void add_global_group(const StringName &p_name, const String &p_description);
@@ -188,6 +403,10 @@ public:
 	void save_scene_groups_cache();
 	String get_scene_groups_cache_path() const;
 	void load_scene_groups_cache();
+	String get_scene_groups_cache_binary_path() const;
+	Error save_scene_groups_cache_binary();
+	bool load_scene_groups_cache_binary();
+	Vector<StringName> get_scenes_in_group(const StringName &p_group) const;
 
 #ifdef TOOLS_ENABLED
 	virtual void get_argument_options(const StringName &p_function, int p_idx, List<String> *r_options) const override;
@@ -195,6 +414,7 @@ public:
 
 	ProjectSettings();
 	ProjectSettings(const String &p_path);
+	explicit ProjectSettings(ProjectSettings *p_parent);
 	~ProjectSettings();
 };
 
@@ -0,0 +1,261 @@
+#include "timer_wheel.h"
+
+#include "core/math/math_funcs.h"
+
+// Slot value of timers that expired and are waiting in the batch to be fired.
+static constexpr uint32_t FIRING_SLOT = UINT32_MAX - 1;
+static constexpr uint32_t GENERATION_MASK = 0x7FFFFFFF; // Top bit is left for the id tag.
+
+uint32_t TimerWheel::_get_index(uint64_t p_id) const {
+	if ((p_id & id_tag) != id_tag) {
+		return NIL;
+	}
+	uint32_t index = uint32_t(p_id & 0xFFFFFFFF);
+	uint32_t generation = uint32_t(p_id >> 32) & GENERATION_MASK;
+	if (index >= timers.size() || timers[index].slot == NIL || timers[index].generation != generation) {
+		return NIL;
+	}
+	return index;
+}
+
+uint32_t TimerWheel::_alloc() {
+	if (free_head != NIL) {
+		uint32_t index = free_head;
+		free_head = timers[index].next;
+		timers[index].next = NIL;
+		return index;
+	}
+	ERR_FAIL_COND_V_MSG(timers.size() >= FIRING_SLOT, NIL, "Too many timers scheduled.");
+	timers.push_back(Timer());
+	return timers.size() - 1;
+}
+
+void TimerWheel::_free(uint32_t p_index) {
+	Timer &t = timers[p_index];
+	t.slot = NIL;
+	t.prev = NIL;
+	t.callable = Callable();
+	t.callback = nullptr;
+	t.userdata = nullptr;
+	t.generation = (t.generation + 1) & GENERATION_MASK;
+	if (t.generation == 0) {
+		t.generation = 1;
+	}
+	t.next = free_head;
+	free_head = p_index;
+}
+
+void TimerWheel::_link(uint32_t p_index) {
+	Timer &t = timers[p_index];
+	uint64_t delta = t.expire_tick - current_tick;
+
+	uint32_t slot = OVERFLOW_SLOT;
+	for (uint32_t level = 0; level < LEVEL_COUNT; level++) {
+		if (delta < (uint64_t(1) << (LEVEL_BITS * (level + 1)))) {
+			slot = level * SLOT_COUNT + uint32_t((t.expire_tick >> (LEVEL_BITS * level)) & SLOT_MASK);
+			break;
+		}
+	}
+
+	t.slot = slot;
+	t.prev = NIL;
+	t.next = slots[slot];
+	if (t.next != NIL) {
+		timers[t.next].prev = p_index;
+	}
+	slots[slot] = p_index;
+}
+
+void TimerWheel::_unlink(uint32_t p_index) {
+	Timer &t = timers[p_index];
+	if (t.prev != NIL) {
+		timers[t.prev].next = t.next;
+	} else {
+		slots[t.slot] = t.next;
+	}
+	if (t.next != NIL) {
+		timers[t.next].prev = t.prev;
+	}
+	t.prev = NIL;
+	t.next = NIL;
+}
+
+// Moves the timers of the current slot of a level down to the levels below it.
+void TimerWheel::_cascade(uint32_t p_level) {
+	uint32_t slot = OVERFLOW_SLOT;
+	uint32_t index = 0;
+	if (p_level < LEVEL_COUNT) {
+		index = uint32_t((current_tick >> (LEVEL_BITS * p_level)) & SLOT_MASK);
+		slot = p_level * SLOT_COUNT + index;
+	}
+
+	uint32_t t = slots[slot];
+	slots[slot] = NIL;
+	while (t != NIL) {
+		uint32_t next = timers[t].next;
+		_link(t);
+		t = next;
+	}
+
+	if (index == 0 && p_level < LEVEL_COUNT) {
+		_cascade(p_level + 1);
+	}
+}
+
+uint64_t TimerWheel::_schedule(double p_delay, uint32_t p_index) {
+	uint64_t delay_ticks = p_delay > 0.0 ? uint64_t(Math::ceil(p_delay * 1000000.0 / tick_usec)) : 0;
+	timers[p_index].expire_tick = current_tick + MAX(delay_ticks, uint64_t(1));
+	_link(p_index);
+	active_count++;
+	return _make_id(p_index);
+}
+
+void TimerWheel::set_tick_usec(uint64_t p_usec) {
+	ERR_FAIL_COND_MSG(p_usec == 0, "Timer wheel tick must be greater than 0.");
+	ERR_FAIL_COND_MSG(active_count > 0, "Can't change the timer wheel tick while timers are pending.");
+	tick_usec = p_usec;
+}
+
+// Delays are in seconds of the time the wheel is advanced with, and are rounded up to
+// the tick resolution.
+uint64_t TimerWheel::schedule(double p_delay, const Callable &p_callable) {
+	uint32_t index = _alloc();
+	ERR_FAIL_COND_V(index == NIL, INVALID_TIMER_ID);
+	timers[index].callable = p_callable;
+	return _schedule(p_delay, index);
+}
+
+uint64_t TimerWheel::schedule(double p_delay, Callback p_callback, void *p_userdata) {
+	ERR_FAIL_NULL_V(p_callback, INVALID_TIMER_ID);
+	uint32_t index = _alloc();
+	ERR_FAIL_COND_V(index == NIL, INVALID_TIMER_ID);
+	timers[index].callback = p_callback;
+	timers[index].userdata = p_userdata;
+	return _schedule(p_delay, index);
+}
+
+bool TimerWheel::cancel(uint64_t p_id) {
+	uint32_t index = _get_index(p_id);
+	if (index == NIL) {
+		return false;
+	}
+	if (timers[index].slot != FIRING_SLOT) {
+		_unlink(index);
+		active_count--;
+	}
+	// If it is waiting in the batch, freeing it bumps its generation so it is skipped.
+	_free(index);
+	return true;
+}
+
+bool TimerWheel::is_pending(uint64_t p_id) const {
+	uint32_t index = _get_index(p_id);
+	return index != NIL && timers[index].slot != FIRING_SLOT;
+}
+
+void TimerWheel::advance(double p_delta) {
+	ERR_FAIL_COND_MSG(!expired.is_empty(), "Timer wheel can't be advanced from one of its own callbacks.");
+	if (p_delta <= 0.0) {
+		return;
+	}
+
+	pending_usec += p_delta * 1000000.0;
+	uint64_t ticks = uint64_t(pending_usec / tick_usec);
+	pending_usec -= double(ticks * tick_usec);
+
+	for (uint64_t i = 0; i < ticks; i++) {
+		if (active_count == 0) {
+			current_tick += ticks - i;
+			break;
+		}
+
+		current_tick++;
+		uint32_t index = uint32_t(current_tick & SLOT_MASK);
+		if (index == 0) {
+			_cascade(1);
+		}
+
+		uint32_t t = slots[index];
+		slots[index] = NIL;
+		while (t != NIL) {
+			uint32_t next = timers[t].next;
+			timers[t].slot = FIRING_SLOT;
+			timers[t].prev = NIL;
+			timers[t].next = NIL;
+			expired.push_back(_make_id(t));
+			active_count--;
+			t = next;
+		}
+	}
+
+	// Fire the whole batch only once the wheel is consistent again, so callbacks
+	// can freely schedule and cancel timers.
+	for (uint32_t i = 0; i < expired.size(); i++) {
+		uint64_t id = expired[i];
+		uint32_t index = _get_index(id);
+		if (index == NIL) {
+			continue; // Cancelled by an earlier callback of this batch.
+		}
+
+		Callable callable = timers[index].callable;
+		Callback callback = timers[index].callback;
+		void *userdata = timers[index].userdata;
+		_free(index);
+		fired_count++;
+
+		if (callback) {
+			callback(id, userdata);
+		} else {
+			callable.call();
+		}
+	}
+	expired.clear();
+}
+
+// Lower bound of the time until the next timer fires, or -1 if there are none. Timers in
+// the upper levels are only known to the precision of their slot, so this may be early.
+double TimerWheel::get_time_to_next_timer() const {
+	if (active_count == 0) {
+		return -1.0;
+	}
+
+	uint64_t next_ticks = UINT64_MAX;
+	for (uint32_t level = 0; level < LEVEL_COUNT; level++) {
+		uint32_t shift = LEVEL_BITS * level;
+		// Above level 0 a timer can be a full turn ahead, in the slot of the current block.
+		uint64_t last = level == 0 ? SLOT_COUNT - 1 : SLOT_COUNT;
+		for (uint64_t i = 1; i <= last; i++) {
+			uint64_t block = (current_tick >> shift) + i;
+			if (slots[level * SLOT_COUNT + uint32_t(block & SLOT_MASK)] != NIL) {
+				uint64_t block_start = level == 0 ? block : block << shift;
+				next_ticks = MIN(next_ticks, block_start - current_tick);
+				break;
+			}
+		}
+	}
+	if (next_ticks == UINT64_MAX) {
+		next_ticks = uint64_t(1) << (LEVEL_BITS * LEVEL_COUNT); // Only overflow timers left.
+	}
+
+	return MAX(0.0, (double(next_ticks * tick_usec) - pending_usec) / 1000000.0);
+}
+
+void TimerWheel::clear() {
+	for (uint32_t i = 0; i < timers.size(); i++) {
+		if (timers[i].slot != NIL) {
+			_free(i);
+		}
+	}
+	for (uint32_t i = 0; i <= OVERFLOW_SLOT; i++) {
+		slots[i] = NIL;
+	}
+	expired.clear();
+	active_count = 0;
+	pending_usec = 0.0;
+}
+
+TimerWheel::TimerWheel() {
+	for (uint32_t i = 0; i <= OVERFLOW_SLOT; i++) {
+		slots[i] = NIL;
+	}
+}
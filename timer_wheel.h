@@ -0,0 +1,82 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "core/templates/local_vector.h"
+#include "core/variant/callable.h"
+
+// Hierarchical timing wheel (4 levels of 256 slots). Scheduling and cancelling are O(1),
+// advancing costs O(1) per elapsed tick plus the timers that fire. Timers live in a pool
+// and are linked by index, so millions of them don't mean millions of allocations.
+// Not thread-safe: owned and advanced by the main loop.
+class TimerWheel {
+public:
+	typedef void (*Callback)(uint64_t p_timer_id, void *p_userdata);
+
+	static constexpr uint64_t INVALID_TIMER_ID = 0;
+
+private:
+	static constexpr uint32_t LEVEL_BITS = 8;
+	static constexpr uint32_t SLOT_COUNT = 1 << LEVEL_BITS;
+	static constexpr uint32_t SLOT_MASK = SLOT_COUNT - 1;
+	static constexpr uint32_t LEVEL_COUNT = 4;
+	static constexpr uint32_t OVERFLOW_SLOT = LEVEL_COUNT * SLOT_COUNT;
+	static constexpr uint32_t NIL = UINT32_MAX;
+
+	struct Timer {
+		uint64_t expire_tick = 0;
+		uint32_t prev = NIL;
+		uint32_t next = NIL;
+		uint32_t slot = NIL; // NIL while the timer is free.
+		uint32_t generation = 1;
+		Callable callable;
+		Callback callback = nullptr;
+		void *userdata = nullptr;
+	};
+
+	LocalVector<Timer> timers;
+	uint32_t free_head = NIL;
+	uint32_t slots[OVERFLOW_SLOT + 1];
+	LocalVector<uint64_t> expired;
+
+	uint64_t id_tag = 0;
+	uint64_t tick_usec = 1000;
+	uint64_t current_tick = 0;
+	double pending_usec = 0.0;
+	uint32_t active_count = 0;
+	uint64_t fired_count = 0;
+
+	_FORCE_INLINE_ uint64_t _make_id(uint32_t p_index) const { return id_tag | (uint64_t(timers[p_index].generation) << 32) | p_index; }
+	uint32_t _get_index(uint64_t p_id) const;
+
+	uint32_t _alloc();
+	void _free(uint32_t p_index);
+	void _link(uint32_t p_index);
+	void _unlink(uint32_t p_index);
+	void _cascade(uint32_t p_level);
+	uint64_t _schedule(double p_delay, uint32_t p_index);
+
+public:
+	// Tag OR-ed into every id, so ids from several wheels can't be mistaken for each other.
+	void set_id_tag(uint64_t p_tag) { id_tag = p_tag; }
+
+	void set_tick_usec(uint64_t p_usec);
+	uint64_t get_tick_usec() const { return tick_usec; }
+
+	uint64_t schedule(double p_delay, const Callable &p_callable);
+	uint64_t schedule(double p_delay, Callback p_callback, void *p_userdata);
+	bool cancel(uint64_t p_id);
+	bool is_pending(uint64_t p_id) const;
+
+	void advance(double p_delta);
+
+	double get_time_to_next_timer() const;
+
+	uint32_t get_pending_count() const { return active_count; }
+	uint64_t get_fired_count() const { return fired_count; }
+
+	void clear();
+
+	TimerWheel();
+};
+
+#endif // TIMER_WHEEL_H